@@ -0,0 +1,154 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Checks that the SIMD color kernels give exactly the same results as the
+ * scalar ones for every possible input, and that the scalar ones round
+ * correctly. Then measures all implementations on common matrix sizes.
+ *
+ * Exits with 1 if any result differs.
+ */
+
+#include "lighting/colorkernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+using colorkernels::Implementation;
+
+static const Implementation implementations[] = { Implementation::Scalar, Implementation::SSE2, Implementation::AVX2 };
+
+/* Rounded a / 255, what the kernels are supposed to compute */
+static int referenceDiv255(int a)
+{
+    return (2 * a + 255) / 510;
+}
+
+/* Every (dst, src) byte pair once: byte i holds dst i >> 8 and src i & 0xff */
+static const int PAIR_COUNT = 256 * 256;
+static const openrazer::MatrixDimensions PAIR_DIMENSIONS = { 255, 86 };
+
+static void fillPairs(Framebuffer &dst, Framebuffer &src)
+{
+    dst.clear();
+    src.clear();
+    for (int i = 0; i < PAIR_COUNT; i++) {
+        dst.bytes()[i] = i >> 8;
+        src.bytes()[i] = i & 0xff;
+    }
+}
+
+static bool failed = false;
+
+/*
+ * Run op with every implementation on all (dst, src) pairs and compare the
+ * results with the scalar implementation and with reference(dst, src).
+ */
+static void checkAllPairs(const char *name, const std::function<void(Framebuffer &, const Framebuffer &)> &op,
+                          const std::function<int(int, int)> &reference)
+{
+    Framebuffer dst(PAIR_DIMENSIONS);
+    Framebuffer src(PAIR_DIMENSIONS);
+    Framebuffer scalarResult;
+
+    for (Implementation implementation : implementations) {
+        colorkernels::setImplementation(implementation);
+        // Not supported by this CPU
+        if (colorkernels::activeImplementation() != implementation)
+            continue;
+
+        fillPairs(dst, src);
+        op(dst, src);
+
+        if (implementation == Implementation::Scalar) {
+            scalarResult = dst;
+            for (int i = 0; i < PAIR_COUNT; i++) {
+                int expected = reference(i >> 8, i & 0xff);
+                if (dst.bytes()[i] != expected) {
+                    std::printf("FAIL %s: scalar gives %d for %d, %d, expected %d\n",
+                                name, dst.bytes()[i], i >> 8, i & 0xff, expected);
+                    failed = true;
+                    break;
+                }
+            }
+        } else if (std::memcmp(dst.bytes(), scalarResult.bytes(), PAIR_COUNT) != 0) {
+            std::printf("FAIL %s: %s differs from scalar\n", name, colorkernels::implementationName(implementation));
+            failed = true;
+        }
+    }
+}
+
+static void checkKernels()
+{
+    for (int alpha = 0; alpha < 256; alpha++) {
+        checkAllPairs(
+                "blendAlpha", [=](Framebuffer &dst, const Framebuffer &src) { colorkernels::blendAlpha(dst, src, alpha); },
+                [=](int d, int s) { return referenceDiv255(d * (255 - alpha) + s * alpha); });
+
+        Framebuffer mask(PAIR_DIMENSIONS);
+        std::memset(mask.bytes(), alpha, mask.byteCount());
+        checkAllPairs(
+                "blendMasked", [&](Framebuffer &dst, const Framebuffer &src) { colorkernels::blendMasked(dst, src, mask); },
+                [=](int d, int s) { return referenceDiv255(d * (255 - alpha) + s * alpha); });
+    }
+
+    checkAllPairs(
+            "blendAdd", [](Framebuffer &dst, const Framebuffer &src) { colorkernels::blendAdd(dst, src); },
+            [](int d, int s) { return d + s > 255 ? 255 : d + s; });
+    checkAllPairs(
+            "blendMultiply", [](Framebuffer &dst, const Framebuffer &src) { colorkernels::blendMultiply(dst, src); },
+            [](int d, int s) { return referenceDiv255(d * s); });
+
+    // The second value is the factor / amount here, src is unused
+    for (int value = 0; value < 256; value++) {
+        checkAllPairs(
+                "scale", [=](Framebuffer &dst, const Framebuffer &) { colorkernels::scale(dst, value); },
+                [=](int d, int) { return referenceDiv255(d * value); });
+        checkAllPairs(
+                "fadeToBlack", [=](Framebuffer &dst, const Framebuffer &) { colorkernels::fadeToBlack(dst, value); },
+                [=](int d, int) { return d - value < 0 ? 0 : d - value; });
+    }
+}
+
+static void measure(const char *name, openrazer::MatrixDimensions dimens, int iterations)
+{
+    Framebuffer dst(dimens);
+    Framebuffer src(dimens);
+    for (int i = 0; i < src.byteCount(); i++) {
+        src.bytes()[i] = i * 7;
+        dst.bytes()[i] = i * 13;
+    }
+
+    for (Implementation implementation : implementations) {
+        colorkernels::setImplementation(implementation);
+        if (colorkernels::activeImplementation() != implementation)
+            continue;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            colorkernels::blendAlpha(dst, src, static_cast<uchar>(i));
+            colorkernels::blendAdd(dst, src);
+            colorkernels::scale(dst, 200);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::printf("%-10s %3dx%-3d %-6s %8.1f ns per blendAlpha + blendAdd + scale\n",
+                    name, dimens.x, dimens.y, colorkernels::implementationName(implementation),
+                    elapsed.count() / iterations);
+    }
+}
+
+int main()
+{
+    checkKernels();
+
+    measure("keyboard", { 6, 22 }, 200000);
+    measure("laptop", { 6, 25 }, 200000);
+    measure("large", { 255, 255 }, 2000);
+
+    std::printf(failed ? "FAIL\n" : "All implementations match\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Opens and repaints the keys of the custom editor for typical layouts, once
+ * drawn by a MatrixCanvas and once as a QPushButton per key like the editor
+ * used to do. Prints the time for opening the editor, for changing the color
+ * of every key and for changing the color of a single key, e.g. while
+ * painting.
+ *
+ * Runs on the offscreen platform unless QT_QPA_PLATFORM says otherwise.
+ * Exits with 1 if a layout can't be found.
+ */
+
+#include "customeditor/matrixcanvas.h"
+
+#include <QApplication>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+struct LedPosition {
+    int row;
+    int column;
+};
+
+/* Stand-in for the editor as it was before the canvas */
+class ButtonGrid : public QWidget
+{
+public:
+    ButtonGrid(const matrixlayouts::Language &layout)
+    {
+        auto *vbox = new QVBoxLayout(this);
+        for (int i = 0; i < layout.rowCount; i++) {
+            const matrixlayouts::Row &row = layout.rows[i];
+
+            auto *hbox = new QHBoxLayout();
+            hbox->setAlignment(Qt::AlignLeft);
+            for (int j = 0; j < row.keyCount; j++) {
+                const matrixlayouts::Key &key = row.keys[j];
+                if (key.label != nullptr) {
+                    auto *button = new QPushButton(QString::fromUtf8(key.label));
+                    button->setFixedSize(key.width, key.height);
+                    button->setEnabled(!key.disabled && key.row >= 0);
+                    hbox->addWidget(button);
+                    if (key.row >= 0)
+                        buttons.insert(key.row << 8 | key.column, button);
+                } else {
+                    hbox->addItem(new QSpacerItem(key.width, 69, QSizePolicy::Fixed, QSizePolicy::Fixed));
+                }
+            }
+            vbox->addLayout(hbox);
+        }
+    }
+
+    void setKeyColor(int row, int column, const QColor &color)
+    {
+        // Same as MatrixPushButton::setButtonColor()
+        double yiq = ((color.red() * 299) + (color.green() * 587) + (color.blue() * 114)) / 1000;
+        QPalette palette(color);
+        palette.setColor(QPalette::ButtonText, (yiq >= 128) ? Qt::black : Qt::white);
+        for (QPushButton *button : buttons.values(row << 8 | column))
+            button->setPalette(palette);
+    }
+
+    QMultiHash<int, QPushButton *> buttons;
+};
+
+static bool failed = false;
+
+static double timeMs(int iterations, const std::function<void(int index)> &run)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        run(i);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+/* Show the editor and wait until it has been painted */
+static void showAndPaint(QWidget *widget)
+{
+    widget->show();
+    widget->repaint();
+    QApplication::processEvents();
+}
+
+template<typename Editor>
+static void measureEditor(const char *name, const char *kind, const QVector<LedPosition> &leds,
+                          const std::function<Editor *()> &create)
+{
+    double openMs = timeMs(20, [&](int) {
+        Editor *editor = create();
+        showAndPaint(editor);
+        delete editor;
+    });
+
+    Editor *editor = create();
+    showAndPaint(editor);
+
+    double allKeysMs = timeMs(100, [&](int index) {
+        QColor color = QColor::fromHsv(index * 7 % 360, 255, 255);
+        for (const LedPosition &led : leds)
+            editor->setKeyColor(led.row, led.column, color);
+        QApplication::processEvents();
+    });
+
+    double singleKeyMs = timeMs(1000, [&](int index) {
+        const LedPosition &led = leds[index % leds.size()];
+        editor->setKeyColor(led.row, led.column, QColor::fromHsv(index % 360, 255, 255));
+        QApplication::processEvents();
+    });
+
+    delete editor;
+
+    std::printf("%-16s %-8s %8.3f ms to open, %8.3f ms to color all keys, %8.3f ms to color a single key\n",
+                name, kind, openMs, allKeysMs, singleKeyMs);
+}
+
+static void measure(const char *type, int rows, int columns, const QString &keyboardLayout = QString())
+{
+    matrixlayouts::Registry::Result result = matrixlayouts::Registry::instance().find(type, rows, columns, keyboardLayout);
+    QByteArray name = QString("%1 %2x%3").arg(type).arg(rows).arg(columns).toUtf8();
+    if (result.language == nullptr) {
+        std::printf("FAIL %s: no layout\n", name.constData());
+        failed = true;
+        return;
+    }
+    const matrixlayouts::Language &layout = *result.language;
+
+    QVector<LedPosition> leds;
+    for (int i = 0; i < layout.rowCount; i++) {
+        for (int j = 0; j < layout.rows[i].keyCount; j++) {
+            const matrixlayouts::Key &key = layout.rows[i].keys[j];
+            if (key.label != nullptr && key.row >= 0)
+                leds.append({ key.row, key.column });
+        }
+    }
+
+    measureEditor<MatrixCanvas>(name.constData(), "canvas", leds, [&]() {
+        auto *canvas = new MatrixCanvas;
+        canvas->setMatrixLayout(layout);
+        return canvas;
+    });
+    measureEditor<ButtonGrid>(name.constData(), "buttons", leds, [&]() {
+        return new ButtonGrid(layout);
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    measure("keyboard", 6, 22, "US");
+    measure("keyboard", 9, 22, "US");
+    measure("keyboard", 6, 25, "US");
+    measure("keypad", 4, 6);
+    measure("mouse", 1, 20);
+
+    return failed ? 1 : 0;
+}
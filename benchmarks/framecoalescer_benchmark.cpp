@@ -0,0 +1,169 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Feeds typical frame sequences through a FrameCoalescer into fake sinks,
+ * one taking a call per row and one taking packed rows like the OpenRazer
+ * daemon. Prints the calls each frame needs and the time per frame spent in
+ * the coalescer and the fake sink. The fake sinks build and marshal the same
+ * messages as DBusFrameSink, but don't send them.
+ *
+ * The fake sinks apply the calls to a copy of the matrix, which has to end up
+ * showing the last frame. Exits with 1 if it doesn't.
+ */
+
+#include "lighting/framecoalescer.h"
+
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+class FakeSink : public FrameSink
+{
+public:
+    FakeSink(openrazer::MatrixDimensions dimens, bool packed)
+        : packed(packed)
+    {
+        device.resize(dimens);
+    }
+
+    void defineCustomFrame(int row, int startColumn, int endColumn, const QVector<openrazer::RGB> &colors) override
+    {
+        // Row, start column, end column followed by the colors
+        payload.resize(3 + colors.size() * 3);
+        payload[0] = static_cast<char>(row);
+        payload[1] = static_cast<char>(startColumn);
+        payload[2] = static_cast<char>(endColumn);
+        std::memcpy(payload.data() + 3, colors.constData(), colors.size() * 3);
+
+        marshal("setKeyRow", { payload });
+        apply(payload);
+    }
+
+    void displayCustomFrame() override
+    {
+        marshal("setCustom", {});
+    }
+
+    bool acceptsPackedRows() const override
+    {
+        return packed;
+    }
+
+    void defineCustomRows(const QByteArray &packedRows) override
+    {
+        marshal("setKeyRow", { packedRows });
+        apply(packedRows);
+    }
+
+    bool packed;
+    Framebuffer device;
+    quint64 calls = 0;
+
+private:
+    /*
+     * Build the message DBusFrameSink would send and marshal its arguments
+     * like QDBusConnection does before sending it.
+     */
+    void marshal(const QString &method, const QVariantList &arguments)
+    {
+        calls++;
+        QDBusMessage message = QDBusMessage::createMethodCall("org.razer", "/org/razer/device/benchmark",
+                                                              "razer.device.lighting.chroma", method);
+        message.setArguments(arguments);
+
+        QDBusArgument marshalled;
+        for (const QVariant &argument : message.arguments())
+            marshalled << argument.toByteArray();
+    }
+
+    void apply(const QByteArray &rows)
+    {
+        // For each row its number, start and end column followed by the colors
+        const uchar *in = reinterpret_cast<const uchar *>(rows.constData());
+        const uchar *end = in + rows.size();
+        while (in < end) {
+            int row = in[0];
+            int startColumn = in[1];
+            int endColumn = in[2];
+            int length = (endColumn - startColumn + 1) * 3;
+            std::memcpy(device.row(row) + startColumn, in + 3, length);
+            in += 3 + length;
+        }
+    }
+
+    QByteArray payload;
+};
+
+static bool failed = false;
+
+/*
+ * Send frameCount frames produced by render(frame, index) through both sinks.
+ */
+static void measure(const char *name, openrazer::MatrixDimensions dimens, int frameCount,
+                    const std::function<void(Framebuffer &frame, int index)> &render)
+{
+    for (bool packed : { false, true }) {
+        FakeSink sink(dimens, packed);
+        FrameCoalescer coalescer(&sink, dimens);
+        Framebuffer frame(dimens);
+
+        std::chrono::duration<double, std::nano> elapsed(0);
+        for (int i = 0; i < frameCount; i++) {
+            render(frame, i);
+
+            auto start = std::chrono::steady_clock::now();
+            coalescer.markAllDirty();
+            coalescer.flush(frame);
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+
+        std::printf("%-12s %3dx%-3d %-8s %6.2f calls per frame, %8.1f ns per frame, %5llu frames displayed, %6llu unchanged rows skipped\n",
+                    name, dimens.x, dimens.y, packed ? "packed" : "per row",
+                    static_cast<double>(sink.calls) / frameCount, elapsed.count() / frameCount,
+                    coalescer.framesSent(), coalescer.rowsSkipped());
+
+        if (std::memcmp(sink.device.bytes(), frame.bytes(), frame.byteCount()) != 0) {
+            std::printf("FAIL %s: the %s sink doesn't show the last frame\n", name, packed ? "packed" : "per row");
+            failed = true;
+        }
+    }
+}
+
+/* Every key changes every frame */
+static void wave(Framebuffer &frame, int index)
+{
+    for (int i = 0; i < frame.byteCount(); i++)
+        frame.bytes()[i] = i + index * 5;
+}
+
+/* A single key changes every frame, e.g. a key press effect */
+static void singleKey(Framebuffer &frame, int index)
+{
+    frame.at(index % frame.rows(), index % frame.columns()) = { 255, static_cast<uchar>(index), 0 };
+}
+
+/* Nothing changes after the first frame, e.g. a static layout */
+static void still(Framebuffer &frame, int index)
+{
+    if (index == 0)
+        frame.fill({ 0, 255, 0 });
+}
+
+int main()
+{
+    const openrazer::MatrixDimensions sizes[] = { { 6, 22 }, { 6, 25 }, { 9, 22 } };
+
+    for (openrazer::MatrixDimensions dimens : sizes) {
+        measure("wave", dimens, 10000, wave);
+        measure("single key", dimens, 10000, singleKey);
+        measure("still", dimens, 10000, still);
+    }
+
+    std::printf(failed ? "FAIL\n" : "All sinks show the last frame\n");
+    return failed ? 1 : 0;
+}
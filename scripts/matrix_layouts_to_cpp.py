@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+# Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+# Compile the matrix layout files in data/matrix_layouts/ into constant C++
+# tables, see src/customeditor/matrixlayouts.h for the data structures.
+#
+# Usage: matrix_layouts_to_cpp.py <output.cpp> <index.json> <layout.json>...
+#
+# index.json maps every layout file to the device type and matrix dimensions
+# it is used for.
+#
+# Malformed layout files fail the build with an error message pointing at the
+# offending key.
+
+import json
+import os
+import re
+import sys
+
+# Geometry used when a key doesn't specify it
+KEY_WIDTH = 60
+KEY_HEIGHT = 63
+SPACER_WIDTH = 66
+SPACER_HEIGHT = 69
+
+KNOWN_PROPERTIES = {"label", "width", "height", "matrix", "disabled"}
+KNOWN_INDEX_PROPERTIES = {"description", "type", "dimensions"}
+DEVICE_TYPES = {"keyboard", "keypad", "mouse", "mousepad"}
+ROW_NAME = re.compile(r"^row[0-9]+$")
+
+
+class LayoutError(Exception):
+    pass
+
+
+def c_string(value):
+    """Encode a string as C string literal, non-ASCII characters as octal escapes."""
+    out = '"'
+    for byte in value.encode("utf-8"):
+        char = chr(byte)
+        if char in '"\\':
+            out += "\\" + char
+        elif 0x20 <= byte < 0x7f:
+            out += char
+        else:
+            out += "\\%03o" % byte
+    return out + '"'
+
+
+def positive_int(value, where):
+    if not isinstance(value, int) or isinstance(value, bool) or value <= 0:
+        raise LayoutError(f"{where}: expected a positive integer, got {json.dumps(value)}")
+    return value
+
+
+def parse_key(obj, where):
+    if not isinstance(obj, dict):
+        raise LayoutError(f"{where}: expected an object")
+    unknown = set(obj.keys()) - KNOWN_PROPERTIES
+    if unknown:
+        raise LayoutError(f"{where}: unknown properties {sorted(unknown)}")
+    if "label" not in obj:
+        raise LayoutError(f"{where}: missing \"label\", use null for spacers")
+
+    label = obj["label"]
+    if label is None:
+        # Spacer, only the width is used
+        width = positive_int(obj.get("width", SPACER_WIDTH), where + ".width")
+        return (None, width, SPACER_HEIGHT, -1, -1, False)
+
+    if not isinstance(label, str):
+        raise LayoutError(f"{where}.label: expected a string or null")
+    width = positive_int(obj.get("width", KEY_WIDTH), where + ".width")
+    height = positive_int(obj.get("height", KEY_HEIGHT), where + ".height")
+    row, column = -1, -1
+    if "matrix" in obj:
+        matrix = obj["matrix"]
+        if (not isinstance(matrix, list) or len(matrix) != 2
+                or any(not isinstance(v, int) or isinstance(v, bool) or not 0 <= v < 256 for v in matrix)):
+            raise LayoutError(f"{where}.matrix: expected [row, column], got {json.dumps(matrix)}")
+        row, column = matrix
+    return (label, width, height, row, column, "disabled" in obj)
+
+
+def parse_rows(obj, where):
+    if not isinstance(obj, dict) or not obj:
+        raise LayoutError(f"{where}: expected an object with rows")
+    rows = []
+    # Rows are shown in the order QJsonObject used to iterate them in
+    for name in sorted(obj.keys()):
+        if not ROW_NAME.match(name):
+            raise LayoutError(f"{where}.{name}: expected a row name like \"row0\"")
+        keys = obj[name]
+        if not isinstance(keys, list):
+            raise LayoutError(f"{where}.{name}: expected an array of keys")
+        rows.append([parse_key(key, f"{where}.{name}[{i}]") for i, key in enumerate(keys)])
+    return rows
+
+
+def parse_index(path):
+    try:
+        with open(path, encoding="utf-8") as f:
+            data = json.load(f)
+    except (OSError, ValueError) as e:
+        raise LayoutError(f"{path}: {e}")
+    if not isinstance(data, dict):
+        raise LayoutError(f"{path}: expected an object")
+
+    index = {}
+    seen = {}
+    for name, entry in data.items():
+        where = f"{path}: {name}"
+        if not isinstance(entry, dict):
+            raise LayoutError(f"{where}: expected an object")
+        unknown = set(entry.keys()) - KNOWN_INDEX_PROPERTIES
+        if unknown:
+            raise LayoutError(f"{where}: unknown properties {sorted(unknown)}")
+        device_type = entry.get("type")
+        if device_type not in DEVICE_TYPES:
+            raise LayoutError(f"{where}.type: expected one of {sorted(DEVICE_TYPES)}")
+        dimensions = entry.get("dimensions")
+        if not isinstance(dimensions, list) or len(dimensions) != 2:
+            raise LayoutError(f"{where}.dimensions: expected [rows, columns]")
+        rows = positive_int(dimensions[0], where + ".dimensions")
+        columns = positive_int(dimensions[1], where + ".dimensions")
+        if (device_type, rows, columns) in seen:
+            raise LayoutError(f"{where}: same type and dimensions as {seen[(device_type, rows, columns)]}")
+        seen[(device_type, rows, columns)] = name
+        index[name] = (device_type, rows, columns)
+    return index
+
+
+def check_dimensions(name, languages, rows, columns):
+    for lang, layout_rows in languages:
+        for keys in layout_rows:
+            for label, _, _, row, column, _ in keys:
+                if row >= rows or column >= columns:
+                    raise LayoutError(f"{name}: key {json.dumps(label)} ({lang or 'no language'}) at [{row}, {column}] "
+                                      f"is outside of the {rows}x{columns} matrix")
+
+
+def parse_layout(path):
+    name = os.path.splitext(os.path.basename(path))[0]
+    if not re.match(r"^[a-z0-9]+$", name):
+        raise LayoutError(f"{path}: layout file names may only contain a-z and 0-9")
+    try:
+        with open(path, encoding="utf-8") as f:
+            data = json.load(f)
+    except (OSError, ValueError) as e:
+        raise LayoutError(f"{path}: {e}")
+    if not isinstance(data, dict) or not data:
+        raise LayoutError(f"{path}: expected a non-empty object")
+
+    # Keyboard layouts are keyed by the keyboard language, all others
+    # directly contain the rows
+    if all(ROW_NAME.match(key) for key in data.keys()):
+        languages = [(None, parse_rows(data, name))]
+    else:
+        languages = [(lang, parse_rows(data[lang], f"{name}.{lang}")) for lang in sorted(data.keys())]
+    return name, languages
+
+
+def generate(index, layouts):
+    out = []
+    out.append("// Generated by scripts/matrix_layouts_to_cpp.py from data/matrix_layouts/, do not edit.")
+    out.append("")
+    out.append('#include "customeditor/matrixlayouts.h"')
+    out.append("")
+    out.append("namespace matrixlayouts {")
+    out.append("")
+    out.append("namespace {")
+
+    layout_entries = []
+    for name, languages in layouts:
+        language_entries = []
+        for lang, rows in languages:
+            prefix = name if lang is None else f"{name}_{re.sub(r'[^A-Za-z0-9]', '_', lang)}"
+            row_entries = []
+            for i, keys in enumerate(rows):
+                ident = f"{prefix}_row{i}"
+                out.append("")
+                out.append(f"constexpr Key {ident}[] = {{")
+                for label, width, height, row, column, disabled in keys:
+                    label_str = "nullptr" if label is None else c_string(label)
+                    out.append(f"    {{ {label_str}, {width}, {height}, {row}, {column}, {'true' if disabled else 'false'} }},")
+                out.append("};")
+                row_entries.append(f"    {{ {ident}, {len(keys)} }},")
+            out.append("")
+            out.append(f"constexpr Row {prefix}_rows[] = {{")
+            out.extend(row_entries)
+            out.append("};")
+            language_entries.append(f"    {{ {'nullptr' if lang is None else c_string(lang)}, {prefix}_rows, {len(rows)} }},")
+        out.append("")
+        out.append(f"constexpr Language {name}_languages[] = {{")
+        out.extend(language_entries)
+        out.append("};")
+        device_type, rows, columns = index[name]
+        layout_entries.append(f"    {{ {c_string(name)}, {c_string(device_type)}, {rows}, {columns}, {name}_languages, {len(languages)} }},")
+
+    out.append("")
+    out.append("}")
+    out.append("")
+    out.append("constexpr Layout layouts[] = {")
+    out.extend(layout_entries)
+    out.append("};")
+    out.append("")
+    out.append(f"constexpr int layoutCount = {len(layouts)};")
+    out.append("")
+    out.append("}")
+    out.append("")
+    return "\n".join(out)
+
+
+def main():
+    if len(sys.argv) < 4:
+        print(f"Usage: {sys.argv[0]} <output.cpp> <index.json> <layout.json>...", file=sys.stderr)
+        return 1
+
+    try:
+        index = parse_index(sys.argv[2])
+        layouts = sorted((parse_layout(path) for path in sys.argv[3:]), key=lambda layout: layout[0])
+        names = {name for name, _ in layouts}
+        for name in sorted(set(index.keys()) - names):
+            raise LayoutError(f"{sys.argv[2]}: {name}: layout file is missing")
+        for name in sorted(names - set(index.keys())):
+            raise LayoutError(f"{sys.argv[2]}: {name}: layout is not listed in the index")
+        for name, languages in layouts:
+            check_dimensions(name, languages, index[name][1], index[name][2])
+    except LayoutError as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    with open(sys.argv[1], "w", encoding="utf-8") as f:
+        f.write(generate(index, layouts))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
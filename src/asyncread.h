@@ -0,0 +1,50 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ASYNCREAD_H
+#define ASYNCREAD_H
+
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <functional>
+#include <libopenrazer.h>
+#include <optional>
+
+namespace util {
+
+/*
+ * Run a blocking libopenrazer getter on pool, so multiple reads can be in
+ * flight at once and a slow device doesn't freeze the GUI. Reads from a
+ * device go to DeviceModel::readPool(), which is drained before the model and
+ * its device get deleted. Once the reply arrives apply() gets called on the
+ * thread of context; if reading failed the warning gets logged and fallback
+ * is passed instead. Nothing gets called if context has been destroyed in the
+ * meantime.
+ */
+template<typename T>
+void readAsync(QThreadPool *pool, QObject *context, std::function<T()> read, T fallback, const char *warning, std::function<void(const T &)> apply)
+{
+    auto *watcher = new QFutureWatcher<std::optional<T>>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context, [=]() {
+        std::optional<T> result = watcher->result();
+        watcher->deleteLater();
+        if (!result.has_value()) {
+            qWarning("%s", warning);
+            apply(fallback);
+        } else {
+            apply(result.value());
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(pool, [=]() -> std::optional<T> {
+        try {
+            return read();
+        } catch (const libopenrazer::DBusException &e) {
+            return std::nullopt;
+        }
+    }));
+}
+
+}
+
+#endif // ASYNCREAD_H
@@ -4,7 +4,6 @@
 
 #include "customeditor.h"
 
-#include "config.h"
 #include "util.h"
 
 #include <QEvent>
@@ -12,24 +11,16 @@
 #include <QPushButton>
 #include <QtWidgets>
 
-CustomEditor::CustomEditor(libopenrazer::Device *device, bool forceFallback, QWidget *parent)
+CustomEditor::CustomEditor(DeviceModel *model, LayerCompositor *compositor, bool forceFallback, QWidget *parent)
     : QDialog(parent)
 {
     setWindowTitle(tr("RazerGenie - Custom Editor"));
-    this->device = device;
+    this->model = model;
+    this->compositor = compositor;
 
     auto *vbox = new QVBoxLayout(this);
 
-    dimens = device->getMatrixDimensions();
-
-    // Initialize internal colors list
-    for (int i = 0; i < dimens.x; i++) {
-        colors << QVector<openrazer::RGB>(dimens.y);
-
-        for (int j = 0; j < dimens.y; j++) {
-            colors[i][j] = openrazer::RGB { 0, 0, 0 };
-        }
-    }
+    dimens = compositor->dimensions();
 
     // Initialize selectedColor variable
     selectedColor = QColor(Qt::green);
@@ -40,32 +31,44 @@ CustomEditor::CustomEditor(libopenrazer::Device *device, bool forceFallback, QWi
     // Add the main controls to the layout
     vbox->addLayout(buildMainControls());
 
-    QString type = device->getDeviceType();
+    QString type = model->type();
+
+    canvas = new MatrixCanvas();
+    connect(canvas, &MatrixCanvas::keyActivated, this, &CustomEditor::onKeyActivated);
+    connect(canvas, &MatrixCanvas::strokeStarted, this, [=]() { painting = true; });
+    connect(canvas, &MatrixCanvas::strokeFinished, this, [=]() {
+        painting = false;
+        commitPaintedKeys();
+    });
 
-    QLayout *deviceLayout = nullptr;
     // Build fallback layout if requested - ignore device type
-    if (forceFallback) {
-        deviceLayout = buildFallback();
-    } else if (type == "keyboard") {
-        deviceLayout = buildKeyboard();
-    } else if (type == "keypad") {
-        deviceLayout = buildKeypad();
-    } else if (type == "mouse") {
-        deviceLayout = buildMouse();
-    } else if (type == "mousepad") {
-        deviceLayout = buildMousepad();
+    bool built = false;
+    if (!forceFallback) {
+        built = buildMatrixLayout(type);
     }
 
-    if (deviceLayout == nullptr) {
-        qWarning("Unsupported custom layout for %s with type %s and dimensions %d x %d. Using fallback layout.",
-                 qUtf8Printable(device->getDeviceName()), qUtf8Printable(type), dimens.x, dimens.y);
-        deviceLayout = buildFallback();
+    if (!built) {
+        if (!forceFallback) {
+            qWarning("Unsupported custom layout for %s with type %s and dimensions %d x %d. Using fallback layout.",
+                     qUtf8Printable(model->name()), qUtf8Printable(type), dimens.x, dimens.y);
+        }
+        canvas->setFallbackLayout(dimens.x, dimens.y);
     }
 
-    vbox->addLayout(deviceLayout);
+    // Large matrices can be scrolled and zoomed
+    auto *scrollArea = new QScrollArea();
+    scrollArea->setWidget(canvas);
+    scrollArea->setAlignment(Qt::AlignCenter);
+    vbox->addWidget(scrollArea);
 
-    // Set every LED to "off"/black
-    clearAll();
+    // Show the whole matrix if it fits on the screen
+    QSize available = screen()->availableGeometry().size() * 0.9;
+    QSize wanted = canvas->sizeHint() + QSize(2 * scrollArea->frameWidth(), 2 * scrollArea->frameWidth());
+    scrollArea->setMinimumSize(wanted.boundedTo(available - QSize(0, vbox->itemAt(0)->sizeHint().height())));
+
+    // Show the keys painted previously and take over the device lighting
+    restoreKeyColors();
+    compositor->setActive(true);
 }
 
 CustomEditor::~CustomEditor() = default;
@@ -107,275 +110,73 @@ QLayout *CustomEditor::buildMainControls()
 }
 
 /*
- * Build layout specific to keyboards, incl. checking physical keyboard layout language.
+ * Build the layout for the device type and matrix dimensions, for keyboards
+ * incl. checking physical keyboard layout language.
  */
-QLayout *CustomEditor::buildKeyboard()
+bool CustomEditor::buildMatrixLayout(const QString &type)
 {
-    // Get the matching layout file name for the dimensions
-    QString layout;
-    if (dimens.x == 6 && dimens.y == 16) { // Razer Blade Stealth (Late 2017)
-        layout = "razerblade16";
-    } else if (dimens.x == 6 && dimens.y == 18) { // Tenkeyless Razer keyboad (e.g. BlackWidow V3 Tenkeyless)
-        layout = "razerdefault18";
-    } else if (dimens.x == 6 && dimens.y == 22) { // "Normal" Razer keyboad (e.g. BlackWidow Chroma)
-        layout = "razerdefault22";
-    } else if (dimens.x == 9 && dimens.y == 22) { // Razer Huntsman Elite
-        layout = "razerhunt22";
-    } else if (dimens.x == 6 && dimens.y == 25) { // Razer Blade Pro 2017
-        layout = "razerblade25";
-    } else {
-        return nullptr;
+    QString kbdLayout;
+    if (type == "keyboard") {
+        try {
+            kbdLayout = model->keyboardLayout();
+        } catch (const libopenrazer::DBusException &e) {
+            qWarning("Failed to get keyboard layout");
+        }
     }
 
-    QJsonDocument keyboardKeysDoc = loadMatrixLayoutJson(layout);
-    if (keyboardKeysDoc.isNull()) {
-        return nullptr;
+    matrixlayouts::Registry::Result result = matrixlayouts::Registry::instance().find(type, dimens.x, dimens.y, kbdLayout);
+    if (result.language == nullptr) {
+        return false;
     }
 
-    QString kbdLayout = device->getKeyboardLayout();
-
     // Show a message when a completely unknown keyboard layout has been detected
     if (kbdLayout == "unknown") {
         util::showInfo(tr("You are using a keyboard with a layout which is not known to the daemon. Please help us by visiting <a href='https://github.com/openrazer/openrazer/wiki/Keyboard-layouts'>https://github.com/openrazer/openrazer/wiki/Keyboard-layouts</a>. Using a fallback layout for now."));
     }
 
-    QJsonObject keyboardKeys = keyboardKeysDoc.object();
-
-    // Check if we have an exact layout match
-    if (keyboardKeys.contains(kbdLayout)) {
-        qInfo("Loaded matching layout for keyboard layout %s.", qUtf8Printable(kbdLayout));
-        return buildLayoutFromJson(keyboardKeys[kbdLayout].toObject());
-    }
-
-    // Otherwise try to get a sane fallback
-    QStringList langs({ "US", "German" });
-    for (const QString &lang : std::as_const(langs)) {
-        if (keyboardKeys.contains(lang)) {
-            qWarning("Failed to find a compatible layout for keyboard layout %s, using %s as fallback.", qUtf8Printable(kbdLayout), qUtf8Printable(lang));
-            return buildLayoutFromJson(keyboardKeys[lang].toObject());
-        }
+    switch (result.match) {
+    case matrixlayouts::Registry::Match::Exact:
+        if (result.language->name != nullptr)
+            qInfo("Loaded matching layout for keyboard layout %s.", qUtf8Printable(kbdLayout));
+        break;
+    case matrixlayouts::Registry::Match::Fallback:
+        qWarning("Failed to find a compatible layout for keyboard layout %s, using %s as fallback.", qUtf8Printable(kbdLayout), result.language->name);
+        break;
+    case matrixlayouts::Registry::Match::Any:
+        qWarning("Failed to find a compatible layout for keyboard layout %s, using any.", qUtf8Printable(kbdLayout));
+        break;
     }
 
-    qWarning("Failed to find a compatible layout for keyboard layout %s, using any.", qUtf8Printable(kbdLayout));
-    return buildLayoutFromJson(keyboardKeys.begin().value().toObject());
+    canvas->setMatrixLayout(*result.language);
+    return true;
 }
 
 /*
- * Build layout specific to keypads (e.g. Tartarus V2)
+ * The painted keys live in the paint layer of the compositor, which outlives
+ * the editor. Color the buttons of keys which have been painted before.
  */
-QLayout *CustomEditor::buildKeypad()
+void CustomEditor::restoreKeyColors()
 {
-    QString layout;
-    if (dimens.x == 4 && dimens.y == 6) {
-        layout = "razerkeypad6";
-    } else {
-        return nullptr;
-    }
-
-    QJsonDocument layoutDoc = loadMatrixLayoutJson(layout);
-    if (layoutDoc.isNull()) {
-        return nullptr;
-    }
-
-    return buildLayoutFromJson(layoutDoc.object());
-}
-
-/*
- * Build layout specific to mice (e.g. Mamba Elite)
- */
-QLayout *CustomEditor::buildMouse()
-{
-    QString layout;
-    if (dimens.x == 1 && dimens.y == 20) {
-        layout = "razermouse20";
-    } else {
-        return nullptr;
-    }
-
-    QJsonDocument layoutDoc = loadMatrixLayoutJson(layout);
-    if (layoutDoc.isNull()) {
-        return nullptr;
-    }
-
-    return buildLayoutFromJson(layoutDoc.object());
-}
-
-/*
- * Build a layout from the provided json.
- *
- * This operates on the object containing the different rows, the keybaord
- * layout needs to be unpacked already.
- *
- * See https://github.com/z3ntu/RazerGenie/wiki/Keyboard-layout-files
- */
-QLayout *CustomEditor::buildLayoutFromJson(QJsonObject layout)
-{
-    auto *vbox = new QVBoxLayout();
-
-    // Iterate over rows in the object
-    QJsonObject::const_iterator it;
-    for (it = layout.constBegin(); it != layout.constEnd(); ++it) {
-        QJsonArray row = (*it).toArray();
-
-        auto *hbox = new QHBoxLayout();
-        hbox->setAlignment(Qt::AlignLeft);
-
-        // Iterate over keys in row
-        QJsonArray::const_iterator jt;
-        for (jt = row.constBegin(); jt != row.constEnd(); ++jt) {
-            QJsonObject obj = (*jt).toObject();
-
-            if (!obj["label"].isNull()) {
-                MatrixPushButton *btn = new MatrixPushButton(obj["label"].toString());
-                int width = obj.contains("width") ? obj.value("width").toInt() : 60;
-                int height = obj.contains("height") ? obj.value("height").toInt() : 63;
-                btn->setFixedSize(width, height);
-                if (obj.contains("matrix")) {
-                    QJsonArray arr = obj["matrix"].toArray();
-                    btn->setMatrixPos(arr[0].toInt(), arr[1].toInt());
-                }
-                if (obj.contains("disabled")) {
-                    btn->setEnabled(false);
+    compositor->readLayer(LayerCompositor::PaintLayer, [=](const Framebuffer &colors, const Framebuffer &mask) {
+        for (int row = 0; row < colors.rows(); row++) {
+            for (int column = 0; column < colors.columns(); column++) {
+                if (mask.at(row, column).r != 0) {
+                    openrazer::RGB color = colors.at(row, column);
+                    canvas->setKeyColor(row, column, QColor(color.r, color.g, color.b));
                 }
-                /*if(obj["cut"] == "enter") {
-                    QPixmap pixmap("../../data/de_DE_mask.png");
-                    btn->setMask(pixmap.mask());
-                }*/
-                connect(btn, &QPushButton::clicked, this, &CustomEditor::onMatrixPushButtonClicked);
-
-                hbox->addWidget(btn);
-                matrixPushButtons.append(btn);
-            } else {
-                int width = obj.contains("width") ? obj.value("width").toInt() : 66;
-                auto *spacer = new QSpacerItem(width, 69, QSizePolicy::Fixed, QSizePolicy::Fixed);
-                hbox->addItem(spacer);
             }
         }
-        vbox->addLayout(hbox);
-    }
-    return vbox;
-}
-
-/*
- * Build layout specific to mousemats (e.g. Firefly)
- */
-QLayout *CustomEditor::buildMousepad()
-{
-    QString layout;
-    if (dimens.x == 1 && dimens.y == 15) {
-        layout = "razermousepad15";
-    } else if (dimens.x == 1 && dimens.y == 19) {
-        layout = "razermousepad19";
-    } else {
-        return nullptr;
-    }
-
-    QJsonDocument layoutDoc = loadMatrixLayoutJson(layout);
-    if (layoutDoc.isNull()) {
-        return nullptr;
-    }
-
-    return buildLayoutFromJson(layoutDoc.object());
-}
-
-/*
- * Build a generic layout that has a button for each index
- */
-QLayout *CustomEditor::buildFallback()
-{
-    auto *vbox = new QVBoxLayout();
-    for (int i = 0; i < dimens.x; i++) {
-        auto *hbox = new QHBoxLayout();
-        for (int j = 0; j < dimens.y; j++) {
-            MatrixPushButton *btn = new MatrixPushButton(QString::number(i) + ":" + QString::number(j));
-            btn->setMatrixPos(i, j);
-
-            connect(btn, &QPushButton::clicked, this, &CustomEditor::onMatrixPushButtonClicked);
-
-            hbox->addWidget(btn);
-            matrixPushButtons.append(btn);
-        }
-        vbox->addLayout(hbox);
-    }
-    return vbox;
-}
-
-/*
- * Load the requested json file from the correct location.
- * On error returns a null QJsonDocument.
- */
-QJsonDocument CustomEditor::loadMatrixLayoutJson(QString jsonname)
-{
-    QFile *file; // Pointer to file object to use
-    QFile file_devel("../../data/matrix_layouts/" + jsonname + ".json"); // File during developemnt
-
-#if defined(Q_OS_MACOS)
-    QString layoutDirectory = QApplication::applicationDirPath() + "/../Resources/matrix_layouts/";
-#else
-    QString layoutDirectory = QString(RAZERGENIE_DATADIR) + "/matrix_layouts/";
-#endif
-    QFile file_prod(layoutDirectory + jsonname + ".json");
-
-    // Try to open the dev file (higher priority)
-    if (file_devel.open(QIODevice::ReadOnly)) {
-        qInfo("RazerGenie: Using the development %s.json file.", qUtf8Printable(jsonname));
-        file = &file_devel;
-    } else {
-        // Try to open the production file
-        if (file_prod.open(QIODevice::ReadOnly)) {
-            qInfo("RazerGenie: Using the production %s.json file.", qUtf8Printable(jsonname));
-            file = &file_prod;
-        } else {
-            util::showInfo(tr("The file %1.json, used for the custom editor failed to load: %2").arg(jsonname, file_prod.errorString()));
-            return QJsonDocument();
-        }
-    }
-
-    // Read the file
-    QTextStream in(file);
-    QString data = in.readAll();
-    file->close();
-
-    // Convert it to a QJsonObject
-    return QJsonDocument::fromJson(data.toUtf8());
-}
-
-void CustomEditor::updateKeyrow(int row)
-{
-    try {
-        device->defineCustomFrame(row, 0, dimens.y - 1, colors[row]);
-        device->displayCustomFrame();
-    } catch (const libopenrazer::DBusException &e) {
-        util::showError(tr("Error updating the lighting data."));
-    }
+    });
 }
 
 void CustomEditor::clearAll()
 {
-    QVector<openrazer::RGB> blankColors;
-    // Initialize the array with the width of the matrix with black = off
-    for (int i = 0; i < dimens.y; i++) {
-        blankColors << openrazer::RGB { 0, 0, 0 };
-    }
-
-    // Send one request per row
-    for (int i = 0; i < dimens.x; i++) {
-        device->defineCustomFrame(i, 0, dimens.y - 1, blankColors);
-    }
-
-    device->displayCustomFrame();
-
     // Reset view
-    for (auto matrixPushButton : std::as_const(matrixPushButtons)) {
-        matrixPushButton->resetButtonColor();
-    }
+    canvas->resetKeyColors();
 
-    // Reset model
-    for (auto &color : colors) {
-        for (auto &j : color) {
-            j = openrazer::RGB { 0, 0, 0 };
-        }
-    }
+    // Reset model, this makes the layers below visible again (black if there are none)
+    compositor->setActive(true);
+    compositor->clearLayer(LayerCompositor::PaintLayer);
 }
 
 void CustomEditor::colorButtonClicked()
@@ -398,23 +199,48 @@ void CustomEditor::colorButtonClicked()
     }
 }
 
-void CustomEditor::onMatrixPushButtonClicked()
+void CustomEditor::onKeyActivated(int row, int column)
 {
-    auto *sender = dynamic_cast<MatrixPushButton *>(QObject::sender());
-    QPair<int, int> pos = sender->matrixPos();
+    openrazer::RGB color;
+    openrazer::RGB alpha;
     if (drawStatus == DrawStatus::set) {
-        // Set color in model
-        colors[pos.first][pos.second] = QCOLOR_TO_RGB(selectedColor);
+        // Painted keys cover the layers below
+        color = QCOLOR_TO_RGB(selectedColor);
+        alpha = openrazer::RGB { 255, 255, 255 };
         // Set color in view
-        sender->setButtonColor(selectedColor);
+        canvas->setKeyColor(row, column, selectedColor);
     } else if (drawStatus == DrawStatus::clear) {
-        // Set color in model
-        colors[pos.first][pos.second] = openrazer::RGB { 0, 0, 0 };
+        // Cleared keys show the layers below again
+        color = openrazer::RGB { 0, 0, 0 };
+        alpha = openrazer::RGB { 0, 0, 0 };
         // Set color in view
-        sender->resetButtonColor();
+        canvas->setKeyColor(row, column, QColor());
     } else {
         throw new std::invalid_argument("Unhandled DrawStatus");
     }
-    // Set color on device
-    updateKeyrow(pos.first);
+    // Keys painted in a stroke get sent to the device together once it is done
+    pendingKeys.append(PaintedKey { row, column, color, alpha });
+    if (!painting) {
+        commitPaintedKeys();
+    }
+}
+
+/*
+ * Write the keys painted since the last call to the model in one go, the
+ * compositor then uploads them with a single update.
+ */
+void CustomEditor::commitPaintedKeys()
+{
+    if (pendingKeys.isEmpty()) {
+        return;
+    }
+
+    compositor->setActive(true);
+    compositor->updateLayer(LayerCompositor::PaintLayer, [=](Framebuffer &colors, Framebuffer &mask) {
+        for (const PaintedKey &key : std::as_const(pendingKeys)) {
+            colors.at(key.row, key.column) = key.color;
+            mask.at(key.row, key.column) = key.alpha;
+        }
+    });
+    pendingKeys.clear();
 }
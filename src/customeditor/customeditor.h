@@ -5,10 +5,11 @@
 #ifndef CUSTOMEDITOR_H
 #define CUSTOMEDITOR_H
 
-#include "matrixpushbutton.h"
+#include "devicemodel.h"
+#include "lighting/layercompositor.h"
+#include "matrixcanvas.h"
 
 #include <QDialog>
-#include <QJsonObject>
 #include <libopenrazer.h>
 
 enum DrawStatus {
@@ -20,33 +21,38 @@ class CustomEditor : public QDialog
 {
     Q_OBJECT
 public:
-    CustomEditor(libopenrazer::Device *device, bool forceFallback = false, QWidget *parent = nullptr);
+    CustomEditor(DeviceModel *model, LayerCompositor *compositor, bool forceFallback = false, QWidget *parent = nullptr);
     ~CustomEditor() override;
 
 private:
     void closeWindow();
     QLayout *buildMainControls();
-    QLayout *buildKeyboard();
-    QLayout *buildKeypad();
-    QLayout *buildMouse();
-    QLayout *buildMousepad();
-    QLayout *buildFallback();
-    QLayout *buildLayoutFromJson(QJsonObject layout);
-
-    QJsonDocument loadMatrixLayoutJson(QString jsonname);
-    void updateKeyrow(int row);
+    bool buildMatrixLayout(const QString &type);
+
+    void restoreKeyColors();
+    void commitPaintedKeys();
     void clearAll();
 
-    QVector<MatrixPushButton *> matrixPushButtons;
-    libopenrazer::Device *device;
+    MatrixCanvas *canvas;
+    DeviceModel *model;
     openrazer::MatrixDimensions dimens;
 
-    QVector<QVector<openrazer::RGB>> colors;
+    LayerCompositor *compositor;
     QColor selectedColor;
     DrawStatus drawStatus;
+
+    struct PaintedKey {
+        int row;
+        int column;
+        openrazer::RGB color;
+        openrazer::RGB alpha;
+    };
+    /* Keys painted in the current stroke, not yet in the model */
+    QVector<PaintedKey> pendingKeys;
+    bool painting = false;
 private slots:
     void colorButtonClicked();
-    void onMatrixPushButtonClicked();
+    void onKeyActivated(int row, int column);
 };
 
 #endif // CUSTOMEDITOR_H
@@ -0,0 +1,450 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "matrixcanvas.h"
+
+#include <QKeyEvent>
+#include <QPainter>
+#include <QStyleOptionButton>
+#include <QToolTip>
+#include <QtMath>
+#include <algorithm>
+
+/* Same spacing as between the buttons in a QHBoxLayout */
+#define KEY_SPACING (6)
+#define CANVAS_MARGIN (4)
+/* Size of the keys of the fallback layout */
+#define FALLBACK_KEY_WIDTH (60)
+#define FALLBACK_KEY_HEIGHT (63)
+
+/* Distance in pixels between the points sampled along a stroke, smaller than any key */
+#define STROKE_STEP (4)
+
+#define MIN_ZOOM (0.25)
+#define MAX_ZOOM (4.0)
+#define ZOOM_STEP (1.25)
+
+MatrixCanvas::MatrixCanvas(QWidget *parent)
+    : QWidget(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    setAccessibleName(tr("LED matrix"));
+}
+
+void MatrixCanvas::setMatrixLayout(const matrixlayouts::Language &layout)
+{
+    clear();
+    for (int i = 0; i < layout.rowCount; i++) {
+        const matrixlayouts::Row &row = layout.rows[i];
+
+        // First measure the row, keys get vertically centered in it
+        int height = 0;
+        for (int j = 0; j < row.keyCount; j++)
+            height = qMax(height, row.keys[j].height);
+
+        beginBand();
+        for (int j = 0; j < row.keyCount; j++) {
+            const matrixlayouts::Key &key = row.keys[j];
+            if (key.label != nullptr) {
+                QRect rect(cursorX, cursorY + (height - key.height) / 2, key.width, key.height);
+                addKey(rect, QString::fromUtf8(key.label), key.row, key.column, !key.disabled && key.row >= 0);
+            }
+            cursorX += key.width + KEY_SPACING;
+        }
+        endBand(height);
+    }
+    finishLayout();
+}
+
+void MatrixCanvas::setFallbackLayout(int rows, int columns)
+{
+    clear();
+    for (int i = 0; i < rows; i++) {
+        beginBand();
+        for (int j = 0; j < columns; j++) {
+            QRect rect(cursorX, cursorY, FALLBACK_KEY_WIDTH, FALLBACK_KEY_HEIGHT);
+            addKey(rect, QString::number(i) + ":" + QString::number(j), i, j, true);
+            cursorX += FALLBACK_KEY_WIDTH + KEY_SPACING;
+        }
+        endBand(FALLBACK_KEY_HEIGHT);
+    }
+    finishLayout();
+}
+
+void MatrixCanvas::setKeyColor(int row, int column, const QColor &color)
+{
+    const auto indices = keysByPosition.values(row << 8 | column);
+    for (int index : indices) {
+        if (keys[index].color == color)
+            continue;
+        keys[index].color = color;
+        updateKey(index);
+    }
+}
+
+void MatrixCanvas::resetKeyColors()
+{
+    for (int i = 0; i < keys.size(); i++) {
+        if (!keys[i].color.isValid())
+            continue;
+        keys[i].color = QColor();
+        updateKey(i);
+    }
+}
+
+void MatrixCanvas::setZoom(qreal zoom)
+{
+    zoom = qBound(MIN_ZOOM, zoom, MAX_ZOOM);
+    if (qFuzzyCompare(zoom, zoomFactor))
+        return;
+
+    zoomFactor = zoom;
+    setFixedSize(sizeHint());
+    update();
+}
+
+qreal MatrixCanvas::zoom() const
+{
+    return zoomFactor;
+}
+
+QSize MatrixCanvas::sizeHint() const
+{
+    return contentSize * zoomFactor;
+}
+
+bool MatrixCanvas::event(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        auto *helpEvent = static_cast<QHelpEvent *>(event);
+        int index = keyAt(helpEvent->pos());
+        if (index >= 0 && keys[index].row >= 0) {
+            const Key &key = keys[index];
+            QToolTip::showText(helpEvent->globalPos(), tr("%1 (row %2, column %3)").arg(key.label).arg(key.row).arg(key.column), this, scaledRect(key.rect));
+        } else {
+            QToolTip::hideText();
+            event->ignore();
+        }
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+/*
+ * Only the keys intersecting the exposed area get drawn, so recoloring a key
+ * costs the same no matter how many keys the matrix has.
+ */
+void MatrixCanvas::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.scale(zoomFactor, zoomFactor);
+
+    QRect exposed = painter.transform().inverted().mapRect(event->rect()).adjusted(-1, -1, 1, 1);
+
+    auto band = std::lower_bound(bands.cbegin(), bands.cend(), exposed.top(),
+                                 [](const Band &band, int y) { return band.bottom < y; });
+    for (; band != bands.cend() && band->top <= exposed.bottom(); ++band) {
+        for (int i = band->firstKey; i < band->endKey; i++) {
+            const Key &key = keys[i];
+            if (key.rect.left() > exposed.right())
+                break;
+            if (!key.rect.intersects(exposed))
+                continue;
+
+            QStyleOptionButton option;
+            option.initFrom(this);
+            option.rect = key.rect;
+            option.text = key.label;
+            option.state &= ~QStyle::State_HasFocus;
+            if (!key.enabled)
+                option.state &= ~QStyle::State_Enabled;
+            option.state |= QStyle::State_Raised;
+            if (i == focusKey && hasFocus())
+                option.state |= QStyle::State_HasFocus;
+
+            if (key.color.isValid()) {
+                // Calculate "the perfect font color" - from https://24ways.org/2010/calculating-color-contrast/
+                double yiq = ((key.color.red() * 299) + (key.color.green() * 587) + (key.color.blue() * 114)) / 1000;
+                option.palette = QPalette(key.color);
+                option.palette.setColor(QPalette::ButtonText, (yiq >= 128) ? Qt::black : Qt::white);
+            }
+
+            style()->drawControl(QStyle::CE_PushButton, &option, &painter, this);
+        }
+    }
+}
+
+void MatrixCanvas::focusInEvent(QFocusEvent *event)
+{
+    if (focusKey < 0)
+        moveFocus(0, 0);
+    else
+        updateKey(focusKey);
+    QWidget::focusInEvent(event);
+}
+
+void MatrixCanvas::focusOutEvent(QFocusEvent *event)
+{
+    if (focusKey >= 0)
+        updateKey(focusKey);
+    QWidget::focusOutEvent(event);
+}
+
+/*
+ * Pressing the left mouse button starts a stroke, every key the mouse passes
+ * over until the button is released gets activated once.
+ */
+void MatrixCanvas::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+
+    stroking = true;
+    strokeKeys.clear();
+    lastStrokeKey = -1;
+    lastStrokePos = event->pos();
+    emit strokeStarted();
+
+    strokeTo(event->pos());
+}
+
+void MatrixCanvas::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!stroking) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+
+    strokeTo(event->pos());
+}
+
+void MatrixCanvas::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton || !stroking) {
+        QWidget::mouseReleaseEvent(event);
+        return;
+    }
+
+    strokeTo(event->pos());
+    stroking = false;
+    emit strokeFinished();
+}
+
+void MatrixCanvas::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Left:
+        moveFocus(-1, 0);
+        break;
+    case Qt::Key_Right:
+        moveFocus(1, 0);
+        break;
+    case Qt::Key_Up:
+        moveFocus(0, -1);
+        break;
+    case Qt::Key_Down:
+        moveFocus(0, 1);
+        break;
+    case Qt::Key_Space:
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        if (focusKey >= 0 && keys[focusKey].enabled)
+            emit keyActivated(keys[focusKey].row, keys[focusKey].column);
+        break;
+    case Qt::Key_Plus:
+        setZoom(zoomFactor * ZOOM_STEP);
+        break;
+    case Qt::Key_Minus:
+        setZoom(zoomFactor / ZOOM_STEP);
+        break;
+    case Qt::Key_0:
+        setZoom(1.0);
+        break;
+    default:
+        QWidget::keyPressEvent(event);
+    }
+}
+
+void MatrixCanvas::wheelEvent(QWheelEvent *event)
+{
+    // Ctrl + wheel zooms, everything else scrolls the surrounding scroll area
+    if (!(event->modifiers() & Qt::ControlModifier) || event->angleDelta().y() == 0) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+
+    setZoom(event->angleDelta().y() > 0 ? zoomFactor * ZOOM_STEP : zoomFactor / ZOOM_STEP);
+    event->accept();
+}
+
+void MatrixCanvas::clear()
+{
+    keys.clear();
+    bands.clear();
+    keysByPosition.clear();
+    focusKey = -1;
+    strokeKeys.clear();
+    lastStrokeKey = -1;
+    cursorX = CANVAS_MARGIN;
+    cursorY = CANVAS_MARGIN;
+    contentSize = QSize();
+}
+
+void MatrixCanvas::beginBand()
+{
+    bands.append(Band { cursorY, cursorY, static_cast<int>(keys.size()), static_cast<int>(keys.size()) });
+    cursorX = CANVAS_MARGIN;
+}
+
+void MatrixCanvas::addKey(const QRect &rect, const QString &label, int row, int column, bool enabled)
+{
+    if (row >= 0)
+        keysByPosition.insert(row << 8 | column, keys.size());
+    keys.append(Key { rect, label, row, column, enabled, QColor() });
+}
+
+void MatrixCanvas::endBand(int height)
+{
+    Band &band = bands.last();
+    band.bottom = cursorY + height - 1;
+    band.endKey = keys.size();
+
+    contentSize = contentSize.expandedTo(QSize(cursorX - KEY_SPACING + CANVAS_MARGIN, 0));
+    cursorY += height + KEY_SPACING;
+}
+
+void MatrixCanvas::finishLayout()
+{
+    contentSize.setHeight(cursorY - KEY_SPACING + CANVAS_MARGIN);
+    setFixedSize(sizeHint());
+    update();
+}
+
+/*
+ * Find the key at a position in widget coordinates, -1 if there is none.
+ * Bands are sorted from top to bottom and keys in a band from left to right,
+ * so this is a binary search in both directions.
+ */
+int MatrixCanvas::keyAt(const QPoint &pos) const
+{
+    QPoint point(qFloor(pos.x() / zoomFactor), qFloor(pos.y() / zoomFactor));
+
+    auto band = std::lower_bound(bands.cbegin(), bands.cend(), point.y(),
+                                 [](const Band &band, int y) { return band.bottom < y; });
+    if (band == bands.cend() || band->top > point.y())
+        return -1;
+
+    auto begin = keys.cbegin() + band->firstKey;
+    auto end = keys.cbegin() + band->endKey;
+    auto key = std::upper_bound(begin, end, point.x(),
+                                [](int x, const Key &key) { return x < key.rect.left(); });
+    if (key == begin)
+        return -1;
+    --key;
+    if (!key->rect.contains(point))
+        return -1;
+    return key - keys.cbegin();
+}
+
+/*
+ * Continue the stroke to pos. Fast mouse movements deliver samples far apart,
+ * so the keys in between are found by walking the line from the previous
+ * sample. Moves within the same key and keys already activated in this
+ * stroke are skipped.
+ */
+void MatrixCanvas::strokeTo(const QPoint &pos)
+{
+    QPoint delta = pos - lastStrokePos;
+    int steps = qMax(1, qMax(qAbs(delta.x()), qAbs(delta.y())) / STROKE_STEP);
+
+    for (int step = 1; step <= steps; step++) {
+        int index = keyAt(lastStrokePos + delta * step / steps);
+        if (index < 0 || index == lastStrokeKey)
+            continue;
+
+        lastStrokeKey = index;
+        if (!keys[index].enabled || strokeKeys.contains(index))
+            continue;
+
+        strokeKeys.insert(index);
+        setFocusKey(index);
+        emit keyActivated(keys[index].row, keys[index].column);
+    }
+    lastStrokePos = pos;
+}
+
+QRect MatrixCanvas::scaledRect(const QRect &rect) const
+{
+    return QRectF(rect.x() * zoomFactor, rect.y() * zoomFactor, rect.width() * zoomFactor, rect.height() * zoomFactor).toAlignedRect();
+}
+
+void MatrixCanvas::updateKey(int index)
+{
+    // Leave some room for the focus frame some styles draw around the key
+    update(scaledRect(keys[index].rect).adjusted(-2, -2, 2, 2));
+}
+
+void MatrixCanvas::setFocusKey(int index)
+{
+    if (index == focusKey)
+        return;
+
+    int previous = focusKey;
+    focusKey = index;
+    if (previous >= 0)
+        updateKey(previous);
+    if (index >= 0) {
+        updateKey(index);
+        setAccessibleDescription(keys[index].label);
+    }
+}
+
+/*
+ * Move the keyboard focus to the next enabled key to the left/right, or to
+ * the enabled key in the row above/below that is horizontally the closest.
+ */
+void MatrixCanvas::moveFocus(int dx, int dy)
+{
+    if (keys.isEmpty())
+        return;
+
+    if (focusKey < 0) {
+        auto first = std::find_if(keys.cbegin(), keys.cend(), [](const Key &key) { return key.enabled; });
+        if (first != keys.cend())
+            setFocusKey(first - keys.cbegin());
+        return;
+    }
+
+    int bandIndex = 0;
+    while (bands[bandIndex].endKey <= focusKey)
+        bandIndex++;
+
+    if (dx != 0) {
+        const Band &band = bands[bandIndex];
+        for (int i = focusKey + dx; i >= band.firstKey && i < band.endKey; i += dx) {
+            if (keys[i].enabled) {
+                setFocusKey(i);
+                return;
+            }
+        }
+        return;
+    }
+
+    int center = keys[focusKey].rect.center().x();
+    for (int b = bandIndex + dy; b >= 0 && b < bands.size(); b += dy) {
+        int best = -1;
+        for (int i = bands[b].firstKey; i < bands[b].endKey; i++) {
+            if (!keys[i].enabled)
+                continue;
+            if (best < 0 || qAbs(keys[i].rect.center().x() - center) < qAbs(keys[best].rect.center().x() - center))
+                best = i;
+        }
+        if (best >= 0) {
+            setFocusKey(best);
+            return;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MATRIXCANVAS_H
+#define MATRIXCANVAS_H
+
+#include "matrixlayouts.h"
+
+#include <QMultiHash>
+#include <QSet>
+#include <QWidget>
+
+/*
+ * Draws all keys of a matrix layout in a single widget, instead of using a
+ * QPushButton per key. Only the keys whose color changed get repainted.
+ *
+ * The canvas has a fixed size depending on the zoom level and is meant to be
+ * put into a QScrollArea for large matrices. Keys can be activated by
+ * dragging the mouse over them, or by moving the focus with the arrow keys
+ * and pressing space.
+ */
+class MatrixCanvas : public QWidget
+{
+    Q_OBJECT
+public:
+    MatrixCanvas(QWidget *parent = nullptr);
+
+    /* Show the keys of a layout from the build-time compiled tables */
+    void setMatrixLayout(const matrixlayouts::Language &layout);
+    /* Show a generic layout with a key for each LED */
+    void setFallbackLayout(int rows, int columns);
+
+    /* An invalid color resets the key to the default look */
+    void setKeyColor(int row, int column, const QColor &color);
+    void resetKeyColors();
+
+    void setZoom(qreal zoom);
+    qreal zoom() const;
+
+    QSize sizeHint() const override;
+
+signals:
+    void keyActivated(int row, int column);
+    /* All keys activated by the mouse between these belong to one stroke */
+    void strokeStarted();
+    void strokeFinished();
+
+protected:
+    bool event(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void focusInEvent(QFocusEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+
+private:
+    struct Key {
+        /* Unscaled geometry */
+        QRect rect;
+        QString label;
+        int row;
+        int column;
+        bool enabled;
+        QColor color;
+    };
+
+    /* Keys are stored row by row, from left to right */
+    struct Band {
+        int top;
+        int bottom;
+        int firstKey;
+        int endKey;
+    };
+
+    void clear();
+    void beginBand();
+    void addKey(const QRect &rect, const QString &label, int row, int column, bool enabled);
+    void endBand(int height);
+    void finishLayout();
+
+    int keyAt(const QPoint &pos) const;
+    void strokeTo(const QPoint &pos);
+    QRect scaledRect(const QRect &rect) const;
+    void updateKey(int index);
+    void setFocusKey(int index);
+    void moveFocus(int dx, int dy);
+
+    QVector<Key> keys;
+    QVector<Band> bands;
+    /* Indices into keys by row << 8 | column */
+    QMultiHash<int, int> keysByPosition;
+    QSize contentSize;
+    int cursorX = 0;
+    int cursorY = 0;
+
+    qreal zoomFactor = 1.0;
+    int focusKey = -1;
+
+    bool stroking = false;
+    QSet<int> strokeKeys;
+    int lastStrokeKey = -1;
+    QPoint lastStrokePos;
+};
+
+#endif // MATRIXCANVAS_H
@@ -0,0 +1,69 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "matrixlayouts.h"
+
+namespace matrixlayouts {
+
+bool Registry::Key::operator==(const Key &other) const
+{
+    return type == other.type && rows == other.rows && columns == other.columns && language == other.language;
+}
+
+size_t qHash(const Registry::Key &key, size_t seed)
+{
+    return qHashMulti(seed, key.type, key.rows, key.columns, key.language);
+}
+
+const Registry &Registry::instance()
+{
+    static const Registry registry;
+    return registry;
+}
+
+Registry::Registry()
+{
+    for (int i = 0; i < layoutCount; i++) {
+        const Layout &layout = layouts[i];
+        const QString type = QString::fromLatin1(layout.type);
+
+        for (int j = 0; j < layout.languageCount; j++) {
+            const Language &language = layout.languages[j];
+            if (language.name != nullptr)
+                index.insert(Key { type, layout.rows, layout.columns, QString::fromLatin1(language.name) }, &language);
+        }
+        // Languages are sorted by name, the first one is the fallback for any language
+        index.insert(Key { type, layout.rows, layout.columns, QString() }, &layout.languages[0]);
+    }
+}
+
+Registry::Result Registry::find(const QString &type, int rows, int columns, const QString &keyboardLayout) const
+{
+    Result result;
+
+    // Check if we have an exact layout match
+    if (!keyboardLayout.isEmpty()) {
+        result.language = index.value(Key { type, rows, columns, keyboardLayout });
+        if (result.language != nullptr)
+            return result;
+    }
+
+    // Otherwise try to get a sane fallback
+    result.match = Match::Fallback;
+    for (const char *lang : { "US", "German" }) {
+        result.language = index.value(Key { type, rows, columns, QString::fromLatin1(lang) });
+        if (result.language != nullptr)
+            return result;
+    }
+
+    result.language = index.value(Key { type, rows, columns, QString() });
+    // Layouts of devices other than keyboards don't have a language at all
+    if (result.language != nullptr && result.language->name == nullptr)
+        result.match = Match::Exact;
+    else
+        result.match = Match::Any;
+    return result;
+}
+
+}
@@ -0,0 +1,106 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MATRIXLAYOUTS_H
+#define MATRIXLAYOUTS_H
+
+#include <QHash>
+#include <QString>
+
+/*
+ * Layouts for the custom editor, compiled from the files in data/matrix_layouts/ at
+ * build time by scripts/matrix_layouts_to_cpp.py. Which layout is used for
+ * which device type and matrix dimensions is defined in
+ * data/matrix_layouts/index.json.
+ *
+ * See https://github.com/z3ntu/RazerGenie/wiki/Keyboard-layout-files
+ */
+namespace matrixlayouts {
+
+struct Key {
+    /* nullptr for spacers */
+    const char *label;
+    int width;
+    int height;
+    /* Position in the LED matrix, -1 if the key has no LED */
+    int row;
+    int column;
+    bool disabled;
+};
+
+struct Row {
+    const Key *keys;
+    int keyCount;
+};
+
+struct Language {
+    /* Keyboard layout as reported by the daemon, nullptr for layouts of
+     * devices other than keyboards */
+    const char *name;
+    const Row *rows;
+    int rowCount;
+};
+
+struct Layout {
+    /* Name of the layout file, e.g. "razerdefault22" */
+    const char *name;
+    /* Device type as reported by the daemon, e.g. "keyboard" */
+    const char *type;
+    int rows;
+    int columns;
+    /* Sorted by name */
+    const Language *languages;
+    int languageCount;
+};
+
+extern const Layout layouts[];
+extern const int layoutCount;
+
+/*
+ * Index over all layouts, built once per process on first use.
+ */
+class Registry
+{
+public:
+    enum class Match {
+        /* The layout has the requested keyboard language, or isn't a keyboard layout */
+        Exact,
+        /* The keyboard language isn't known, a common one got picked instead */
+        Fallback,
+        /* Neither the keyboard language nor a common one is known, the first one got picked */
+        Any,
+    };
+
+    struct Result {
+        /* nullptr if there is no layout for the device */
+        const Language *language = nullptr;
+        Match match = Match::Exact;
+    };
+
+    static const Registry &instance();
+
+    /* Find the layout for a device, for keyboards falling back from the
+     * exact keyboard language to US, German and finally any language. */
+    Result find(const QString &type, int rows, int columns, const QString &keyboardLayout = QString()) const;
+
+private:
+    Registry();
+
+    struct Key {
+        QString type;
+        int rows;
+        int columns;
+        /* Empty for the fallback to any language */
+        QString language;
+
+        bool operator==(const Key &other) const;
+    };
+    friend size_t qHash(const Key &key, size_t seed);
+
+    QHash<Key, const Language *> index;
+};
+
+}
+
+#endif // MATRIXLAYOUTS_H
@@ -0,0 +1,71 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "devicecommandqueue.h"
+
+#include <libopenrazer.h>
+
+DeviceCommandQueue::DeviceCommandQueue(QObject *parent)
+    : QObject(parent)
+{
+    // Writes to one device must not overtake each other
+    pool.setMaxThreadCount(1);
+}
+
+DeviceCommandQueue::~DeviceCommandQueue()
+{
+    pool.waitForDone();
+}
+
+void DeviceCommandQueue::submit(const QString &key, std::function<void()> write, QObject *context, std::function<void()> failed)
+{
+    QMutexLocker locker(&mutex);
+    if (pending.contains(key)) {
+        // Keeps its place in the queue, only the value changes
+        coalescedCount++;
+    } else {
+        order.append(key);
+    }
+    pending.insert(key, { write, context, failed });
+
+    if (!draining) {
+        draining = true;
+        pool.start([this]() { drain(); });
+    }
+}
+
+void DeviceCommandQueue::drain()
+{
+    while (true) {
+        Command command;
+        {
+            QMutexLocker locker(&mutex);
+            if (order.isEmpty()) {
+                draining = false;
+                return;
+            }
+            command = pending.take(order.takeFirst());
+            writeCount++;
+        }
+
+        try {
+            command.write();
+        } catch (const libopenrazer::DBusException &e) {
+            if (!command.context.isNull() && command.failed)
+                QMetaObject::invokeMethod(command.context, command.failed, Qt::QueuedConnection);
+        }
+    }
+}
+
+quint64 DeviceCommandQueue::writes() const
+{
+    QMutexLocker locker(&mutex);
+    return writeCount;
+}
+
+quint64 DeviceCommandQueue::coalescedWrites() const
+{
+    QMutexLocker locker(&mutex);
+    return coalescedCount;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DEVICECOMMANDQUEUE_H
+#define DEVICECOMMANDQUEUE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <functional>
+
+/*
+ * Runs writes to a device one after another on a worker thread, so the GUI
+ * never waits for the device.
+ *
+ * Writes are queued under a key naming the property they change. A write
+ * replacing one with the same key that hasn't started yet takes its place,
+ * so dragging a slider only sends the latest value once the device is ready
+ * instead of every step in between.
+ *
+ * Pending writes are still sent when the queue gets destroyed.
+ */
+class DeviceCommandQueue : public QObject
+{
+    Q_OBJECT
+public:
+    DeviceCommandQueue(QObject *parent = nullptr);
+    ~DeviceCommandQueue() override;
+
+    /* Queue write, which may throw libopenrazer::DBusException. If it does,
+     * failed gets called on the thread of context, unless context has been
+     * destroyed in the meantime. */
+    void submit(const QString &key, std::function<void()> write, QObject *context, std::function<void()> failed);
+
+    /* Writes sent to the device, and writes replaced by a newer one before
+     * they got sent */
+    quint64 writes() const;
+    quint64 coalescedWrites() const;
+
+private:
+    struct Command {
+        std::function<void()> write;
+        QPointer<QObject> context;
+        std::function<void()> failed;
+    };
+
+    void drain();
+
+    QThreadPool pool;
+
+    mutable QMutex mutex;
+    QHash<QString, Command> pending;
+    /* Keys of the pending commands, oldest first */
+    QStringList order;
+    bool draining = false;
+    quint64 writeCount = 0;
+    quint64 coalescedCount = 0;
+};
+
+#endif // DEVICECOMMANDQUEUE_H
@@ -4,12 +4,14 @@
 
 #include "deviceinfodialog.h"
 
+#include "asyncread.h"
+
 #include <QFormLayout>
 #include <QLabel>
 #include <QScrollArea>
 #include <QVBoxLayout>
 
-DeviceInfoDialog::DeviceInfoDialog(libopenrazer::Device *device, QWidget *parent)
+DeviceInfoDialog::DeviceInfoDialog(DeviceModel *model, QWidget *parent)
     : QDialog(parent)
 {
     setWindowTitle(tr("RazerGenie - Device info"));
@@ -48,28 +50,36 @@ DeviceInfoDialog::DeviceInfoDialog(libopenrazer::Device *device, QWidget *parent
     formLayout->addRow(aboutSeparator);
 
     /* Serial number */
-    QString serial = "error";
-    try {
-        serial = device->getSerial();
-    } catch (const libopenrazer::DBusException &e) {
-        qWarning("Failed to get serial");
-    }
     QLabel *serialLabel = new QLabel(this);
-    serialLabel->setText(serial);
+    serialLabel->setText("…");
+    util::readAsync<QString>(
+            model->readPool(), this, [=]() { return model->serial(); }, "error", "Failed to get serial",
+            [=](const QString &serial) { serialLabel->setText(serial); });
     serialLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
     formLayout->addRow(tr("Serial number:"), serialLabel);
 
     /* Firmware version */
-    QString firmwareVersion = "error";
-    try {
-        firmwareVersion = device->getFirmwareVersion();
-    } catch (const libopenrazer::DBusException &e) {
-        qWarning("Failed to get firmware version");
-    }
     QLabel *firmwareVersionLabel = new QLabel(this);
-    firmwareVersionLabel->setText(firmwareVersion);
+    firmwareVersionLabel->setText("…");
+    util::readAsync<QString>(
+            model->readPool(), this, [=]() { return model->firmwareVersion(); }, "error", "Failed to get firmware version",
+            [=](const QString &firmwareVersion) { firmwareVersionLabel->setText(firmwareVersion); });
     firmwareVersionLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
     formLayout->addRow(tr("Firmware version:"), firmwareVersionLabel);
+
+    /* Values RazerGenie didn't have to ask the device for */
+    quint64 cacheHits = model->cacheHits();
+    quint64 cacheLookups = cacheHits + model->cacheMisses();
+    QLabel *cacheLabel = new QLabel(this);
+    cacheLabel->setText(tr("%1 of %2 reads").arg(cacheHits).arg(cacheLookups));
+    formLayout->addRow(tr("Served from cache:"), cacheLabel);
+
+    /* Slider steps which never had to be sent */
+    QLabel *writesLabel = new QLabel(this);
+    writesLabel->setText(tr("%1 sent, %2 skipped as outdated")
+                                 .arg(model->commandQueue()->writes())
+                                 .arg(model->commandQueue()->coalescedWrites()));
+    formLayout->addRow(tr("Writes:"), writesLabel);
 }
 
 DeviceInfoDialog::~DeviceInfoDialog() = default;
@@ -5,14 +5,15 @@
 #ifndef DEVICEINFODIALOG_H
 #define DEVICEINFODIALOG_H
 
+#include "devicemodel.h"
+
 #include <QDialog>
-#include <libopenrazer.h>
 
 class DeviceInfoDialog : public QDialog
 {
     Q_OBJECT
 public:
-    DeviceInfoDialog(libopenrazer::Device *device, QWidget *parent = nullptr);
+    DeviceInfoDialog(DeviceModel *model, QWidget *parent = nullptr);
     ~DeviceInfoDialog() override;
 };
 
@@ -4,51 +4,61 @@
 
 #include "devicelistwidget.h"
 
-#include "razerimagedownloader.h"
+#include "asyncread.h"
+#include "thumbnailcache.h"
 
-#include <QFileInfo>
 #include <QIcon>
 #include <QLabel>
 #include <QVBoxLayout>
 
-DeviceListWidget::DeviceListWidget(QWidget *parent, libopenrazer::Device *device)
+DeviceListWidget::DeviceListWidget(QWidget *parent, DeviceModel *model)
     : QWidget(parent)
 {
-    this->mDevice = device;
+    this->mModel = model;
 
     auto *layout = new QVBoxLayout(this);
     layout->setContentsMargins(2, 2, 2, 2);
 
-    // Add icon
-    QString path = RazerImageDownloader::getDownloadPath() + device->getDeviceImageUrl().split("/").takeLast();
-    if (QFile(path).exists() && QFileInfo(path).isFile()) {
-        QPixmap scaled = createPixmapFromFile(path);
-        imageLabel = new QLabel(this);
-        imageLabel->setPixmap(scaled);
-    } else {
-        imageLabel = new QLabel(tr("Downloading image..."), this);
-    }
+    // Add icon, left empty until the downloader has the image
+    imageLabel = new QLabel(this);
+    imageLabel->setMinimumSize(150, 75);
     imageLabel->setAlignment(Qt::AlignCenter);
     imageLabel->setWordWrap(true);
     layout->addWidget(imageLabel);
 
-    QLabel *deviceName = new QLabel(device->getDeviceName(), this);
+    // The device might be slow or asleep, fill in the name once it's known
+    QLabel *deviceName = new QLabel("…", this);
+    util::readAsync<QString>(
+            model->readPool(), this, [=]() { return model->name(); }, tr("Unknown device"), "Failed to get device name",
+            [=](const QString &name) { deviceName->setText(name); });
     deviceName->setWordWrap(true);
     deviceName->setAlignment(Qt::AlignCenter);
     layout->addWidget(deviceName);
 }
 
-QPixmap DeviceListWidget::createPixmapFromFile(QString &filename)
+/*
+ * Decoding and scaling the full-size image is slow, so it happens on the
+ * thread pool; only the conversion to a QPixmap is left for the GUI thread.
+ */
+void DeviceListWidget::loadImage(const QString &filename)
 {
-    QPixmap icon(filename);
-    return icon.scaled(150, 75, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    qreal devicePixelRatio = devicePixelRatioF();
+    util::readAsync<QImage>(
+            QThreadPool::globalInstance(), this, [=]() { return thumbnailcache::thumbnail(filename, QSize(150, 75), devicePixelRatio); },
+            QImage(), "Failed to load device image",
+            [=](const QImage &image) {
+                if (image.isNull()) {
+                    imageDownloadErrored(tr("Invalid image"), tr("The device image couldn't be loaded."));
+                    return;
+                }
+                imageLabel->setPixmap(QPixmap::fromImage(image));
+            });
 }
 
 void DeviceListWidget::imageDownloaded(QString &filename)
 {
     qDebug() << "DeviceListWidget: Received signal!" << filename;
-    QPixmap scaled = createPixmapFromFile(filename);
-    imageLabel->setPixmap(scaled);
+    loadImage(filename);
 }
 
 void DeviceListWidget::imageDownloadErrored(QString reason, QString longReason)
@@ -63,9 +73,9 @@ void DeviceListWidget::imageDownloadErrored(QString reason, QString longReason)
     imageLabel->setPixmap(placeholder);
 }
 
-libopenrazer::Device *DeviceListWidget::device()
+DeviceModel *DeviceListWidget::model()
 {
-    return mDevice;
+    return mModel;
 }
 
 void DeviceListWidget::setNoImage()
@@ -5,24 +5,25 @@
 #ifndef DEVICELISTWIDGET_H
 #define DEVICELISTWIDGET_H
 
+#include "devicemodel.h"
+
 #include <QLabel>
 #include <QWidget>
-#include <libopenrazer.h>
 
 class DeviceListWidget : public QWidget
 {
     Q_OBJECT
 public:
-    DeviceListWidget(QWidget *parent, libopenrazer::Device *device);
-    libopenrazer::Device *device();
+    DeviceListWidget(QWidget *parent, DeviceModel *model);
+    DeviceModel *model();
     void setNoImage();
 public slots:
     void imageDownloaded(QString &filename);
     void imageDownloadErrored(QString reason, QString longReason);
 
 private:
-    QPixmap createPixmapFromFile(QString &filename);
-    libopenrazer::Device *mDevice;
+    void loadImage(const QString &filename);
+    DeviceModel *mModel;
     QLabel *imageLabel;
 };
 
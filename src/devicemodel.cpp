@@ -0,0 +1,526 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "devicemodel.h"
+
+#include <QDBusError>
+#include <QWaitCondition>
+#include <exception>
+#include <memory>
+#include <optional>
+
+/* Battery values change without us doing anything */
+#define BATTERY_MAX_AGE_MS (30 * 1000)
+/* Time a caller waits for a call to the device */
+#define DEVICE_CALL_DEADLINE_MS (2000)
+/* Reads from one device running at the same time */
+#define DEVICE_MAX_FETCHES (4)
+/* Timeouts in a row after which the device is considered unresponsive */
+#define DEVICE_MAX_TIMEOUTS (3)
+/* Interval for checking whether an unresponsive device is back */
+#define DEVICE_PROBE_INTERVAL_MS (5000)
+
+/* The model whose call is running on this thread, if any */
+static thread_local DeviceModel *runningCallModel = nullptr;
+
+DeviceModel::DeviceModel(libopenrazer::Device *device, QObject *parent)
+    : QObject(parent), mDevice(device), commands(new DeviceCommandQueue(this))
+{
+    // Writes to one device don't overtake each other
+    callThread.setMaxThreadCount(1);
+    fetchThreads.setMaxThreadCount(DEVICE_MAX_FETCHES);
+
+    probeTimer = new QTimer(this);
+    probeTimer->setInterval(DEVICE_PROBE_INTERVAL_MS);
+    connect(probeTimer, &QTimer::timeout, this, &DeviceModel::probe);
+}
+
+DeviceModel::~DeviceModel()
+{
+    // Reads which haven't started yet have no one to report to anymore
+    readThreads.clear();
+    readThreads.waitForDone();
+    // Send the pending writes while the device is still around
+    delete commands;
+    callThread.clear();
+    callThread.waitForDone();
+    fetchThreads.clear();
+    fetchThreads.waitForDone();
+
+    delete mDevice;
+    qDeleteAll(retiredDevices);
+}
+
+libopenrazer::Device *DeviceModel::device() const
+{
+    QMutexLocker locker(&mutex);
+    return mDevice;
+}
+
+void DeviceModel::callDevice(const std::function<void(libopenrazer::Device *)> &fn)
+{
+    run([=]() { fn(device()); });
+}
+
+void DeviceModel::rebind(libopenrazer::Device *device)
+{
+    QHash<int, LedSnapshot> snapshots;
+    {
+        QMutexLocker locker(&mutex);
+        retiredDevices.append(mDevice);
+        mDevice = device;
+        cache.clear();
+        generation++;
+        snapshots = ledSnapshots;
+        consecutiveTimeouts = 0;
+    }
+    // Give the new device a chance
+    setResponsive(true);
+
+    // Restore the lighting, the LEDs have been looked up again by now
+    for (auto it = snapshots.constBegin(); it != snapshots.constEnd(); ++it) {
+        openrazer::LedId ledId = static_cast<openrazer::LedId>(it.key());
+        LedSnapshot snapshot = it.value();
+        try {
+            run([=]() {
+                libopenrazer::Led *led = this->led(ledId);
+                if (led == nullptr)
+                    return;
+                if (snapshot.effect)
+                    snapshot.effect(led);
+                if (snapshot.brightness != -1)
+                    led->setBrightness(snapshot.brightness);
+            });
+        } catch (const libopenrazer::DBusException &e) {
+            qWarning("Failed to restore lighting");
+        }
+    }
+
+    emit rebound();
+}
+
+DeviceCommandQueue *DeviceModel::commandQueue()
+{
+    return commands;
+}
+
+QThreadPool *DeviceModel::readPool()
+{
+    return &readThreads;
+}
+
+/*
+ * Return the cached value for key, or fetch and cache it. The fetch happens
+ * without holding the lock, so a slow device doesn't block other lookups;
+ * two threads missing at the same time both fetch.
+ */
+template<typename T>
+T DeviceModel::cached(const QString &key, const std::function<T()> &fetch, qint64 maxAgeMs)
+{
+    int fetchGeneration;
+    {
+        QMutexLocker locker(&mutex);
+        auto it = cache.constFind(key);
+        if (it != cache.constEnd() && !it->expiry.hasExpired()) {
+            hits++;
+            return std::any_cast<T>(it->value);
+        }
+        misses++;
+        fetchGeneration = generation;
+    }
+
+    T value = call<T>(fetch);
+
+    QMutexLocker locker(&mutex);
+    if (fetchGeneration != generation)
+        return value;
+    Entry &entry = cache[key];
+    entry.value = value;
+    entry.expiry = maxAgeMs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(maxAgeMs);
+    return value;
+}
+
+template<typename T>
+void DeviceModel::store(const QString &key, const T &value)
+{
+    QMutexLocker locker(&mutex);
+    cache[key] = { value, QDeadlineTimer(QDeadlineTimer::Forever) };
+    // A read running next to the write might have got the old value
+    generation++;
+}
+
+void DeviceModel::run(const std::function<void()> &fn)
+{
+    run(fn, &callThread);
+}
+
+/*
+ * Run fn on threads, waiting at most DEVICE_CALL_DEADLINE_MS. Throws
+ * libopenrazer::DBusException if the device is unresponsive or the deadline
+ * passed, otherwise whatever fn throws.
+ */
+void DeviceModel::run(const std::function<void()> &fn, QThreadPool *threads)
+{
+    // Calls made while running another one, e.g. led() while getting the
+    // brightness, would wait for themselves
+    if (runningCallModel == this) {
+        fn();
+        return;
+    }
+
+    if (!isResponsive())
+        throw libopenrazer::DBusException(QDBusError(QDBusError::NoReply, "Device is not responding"));
+
+    struct CallState {
+        QMutex mutex;
+        QWaitCondition done;
+        bool finished = false;
+        bool cancelled = false;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<CallState>();
+
+    threads->start([=]() {
+        {
+            QMutexLocker locker(&state->mutex);
+            // Nobody waits for the result anymore
+            if (state->cancelled)
+                return;
+        }
+
+        std::exception_ptr error;
+        runningCallModel = this;
+        try {
+            fn();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        runningCallModel = nullptr;
+        callCompleted();
+
+        QMutexLocker locker(&state->mutex);
+        state->error = error;
+        state->finished = true;
+        state->done.wakeAll();
+    });
+
+    QDeadlineTimer deadline(DEVICE_CALL_DEADLINE_MS);
+    QMutexLocker locker(&state->mutex);
+    while (!state->finished) {
+        if (!state->done.wait(&state->mutex, deadline) && !state->finished) {
+            state->cancelled = true;
+            locker.unlock();
+            callTimedOut();
+            throw libopenrazer::DBusException(QDBusError(QDBusError::Timeout, "Device didn't respond in time"));
+        }
+    }
+
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
+template<typename T>
+T DeviceModel::call(const std::function<T()> &fn)
+{
+    // Shared, the call might finish after the caller gave up on it
+    auto result = std::make_shared<std::optional<T>>();
+    run([=]() { *result = fn(); }, &fetchThreads);
+    return result->value();
+}
+
+void DeviceModel::callCompleted()
+{
+    QMutexLocker locker(&mutex);
+    consecutiveTimeouts = 0;
+}
+
+void DeviceModel::callTimedOut()
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (++consecutiveTimeouts < DEVICE_MAX_TIMEOUTS)
+            return;
+    }
+
+    QMetaObject::invokeMethod(this, [=]() { setResponsive(false); });
+}
+
+/*
+ * Check in the background whether an unresponsive device replies again.
+ */
+void DeviceModel::probe()
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (probeRunning)
+            return;
+        probeRunning = true;
+    }
+
+    callThread.start([=]() {
+        bool replied = true;
+        try {
+            device()->getFirmwareVersion();
+        } catch (const libopenrazer::DBusException &e) {
+            replied = false;
+        }
+
+        {
+            QMutexLocker locker(&mutex);
+            probeRunning = false;
+            if (replied)
+                consecutiveTimeouts = 0;
+        }
+
+        if (replied) {
+            QMetaObject::invokeMethod(this, [=]() {
+                // Whatever we know might be outdated by now
+                invalidateState();
+                setResponsive(true);
+            });
+        }
+    });
+}
+
+void DeviceModel::setResponsive(bool responsive)
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (this->responsive == responsive)
+            return;
+        this->responsive = responsive;
+    }
+
+    if (responsive) {
+        qDebug("DeviceModel: Device is responding again");
+        probeTimer->stop();
+    } else {
+        qWarning("DeviceModel: Device is not responding, failing calls until it does again");
+        probeTimer->start();
+    }
+    emit responsiveChanged(responsive);
+}
+
+bool DeviceModel::isResponsive() const
+{
+    QMutexLocker locker(&mutex);
+    return responsive;
+}
+
+void DeviceModel::invalidate(const QString &prefix)
+{
+    QMutexLocker locker(&mutex);
+    generation++;
+    cache.removeIf([&](const QHash<QString, Entry>::iterator &it) {
+        return it.key().startsWith(prefix);
+    });
+}
+
+QDBusObjectPath DeviceModel::objectPath()
+{
+    return cached<QDBusObjectPath>("objectPath", [=]() { return device()->objectPath(); });
+}
+
+QString DeviceModel::name()
+{
+    return cached<QString>("name", [=]() { return device()->getDeviceName(); });
+}
+
+QString DeviceModel::type()
+{
+    return cached<QString>("type", [=]() { return device()->getDeviceType(); });
+}
+
+bool DeviceModel::hasFeature(const QString &feature)
+{
+    return cached<bool>("feature/" + feature, [=]() { return device()->hasFeature(feature); });
+}
+
+QVector<libopenrazer::Led *> DeviceModel::leds()
+{
+    return cached<QVector<libopenrazer::Led *>>("leds", [=]() { return device()->getLeds(); });
+}
+
+libopenrazer::Led *DeviceModel::led(openrazer::LedId ledId)
+{
+    return cached<libopenrazer::Led *>("led/" + QString::number(static_cast<int>(ledId)), [=]() -> libopenrazer::Led * {
+        for (libopenrazer::Led *led : leds()) {
+            if (led->getLedId() == ledId)
+                return led;
+        }
+        return nullptr;
+    });
+}
+
+QString DeviceModel::imageUrl()
+{
+    return cached<QString>("imageUrl", [=]() { return device()->getDeviceImageUrl(); });
+}
+
+openrazer::MatrixDimensions DeviceModel::matrixDimensions()
+{
+    return cached<openrazer::MatrixDimensions>("matrixDimensions", [=]() { return device()->getMatrixDimensions(); });
+}
+
+QString DeviceModel::keyboardLayout()
+{
+    return cached<QString>("keyboardLayout", [=]() { return device()->getKeyboardLayout(); });
+}
+
+QString DeviceModel::serial()
+{
+    return cached<QString>("serial", [=]() { return device()->getSerial(); });
+}
+
+QString DeviceModel::firmwareVersion()
+{
+    return cached<QString>("firmwareVersion", [=]() { return device()->getFirmwareVersion(); });
+}
+
+int DeviceModel::maxDPI()
+{
+    return cached<int>("maxDPI", [=]() { return device()->maxDPI(); });
+}
+
+QVector<ushort> DeviceModel::allowedDPI()
+{
+    return cached<QVector<ushort>>("allowedDPI", [=]() { return device()->getAllowedDPI(); });
+}
+
+QVector<ushort> DeviceModel::supportedPollRates()
+{
+    return cached<QVector<ushort>>("supportedPollRates", [=]() { return device()->getSupportedPollRates(); });
+}
+
+uchar DeviceModel::brightness(openrazer::LedId ledId)
+{
+    return cached<uchar>("state/brightness/" + QString::number(static_cast<int>(ledId)), [=]() {
+        return led(ledId)->getBrightness();
+    });
+}
+
+void DeviceModel::setBrightness(openrazer::LedId ledId, uchar brightness)
+{
+    run([=]() { led(ledId)->setBrightness(brightness); });
+    store<uchar>("state/brightness/" + QString::number(static_cast<int>(ledId)), brightness);
+
+    QMutexLocker locker(&mutex);
+    ledSnapshots[static_cast<int>(ledId)].brightness = brightness;
+}
+
+void DeviceModel::applyEffect(openrazer::LedId ledId, const std::function<void(libopenrazer::Led *)> &apply)
+{
+    // Read back the effect and colors the daemon ends up with next time
+    invalidateEffects();
+
+    run([=]() { apply(led(ledId)); });
+
+    QMutexLocker locker(&mutex);
+    ledSnapshots[static_cast<int>(ledId)].effect = apply;
+}
+
+openrazer::Effect DeviceModel::currentEffect(openrazer::LedId ledId)
+{
+    return cached<openrazer::Effect>("state/effect/" + QString::number(static_cast<int>(ledId)), [=]() {
+        return led(ledId)->getCurrentEffect();
+    });
+}
+
+QVector<openrazer::RGB> DeviceModel::currentColors(openrazer::LedId ledId)
+{
+    return cached<QVector<openrazer::RGB>>("state/colors/" + QString::number(static_cast<int>(ledId)), [=]() {
+        return led(ledId)->getCurrentColors();
+    });
+}
+
+void DeviceModel::invalidateEffects()
+{
+    invalidate("state/effect/");
+    invalidate("state/colors/");
+}
+
+openrazer::DPI DeviceModel::dpi()
+{
+    return cached<openrazer::DPI>("state/dpi/current", [=]() { return device()->getDPI(); });
+}
+
+void DeviceModel::setDPI(openrazer::DPI dpi)
+{
+    run([=]() { device()->setDPI(dpi); });
+    store<openrazer::DPI>("state/dpi/current", dpi);
+    // The active stage changes as well
+    invalidate("state/dpi/stages");
+}
+
+QPair<uchar, QVector<openrazer::DPI>> DeviceModel::dpiStages()
+{
+    return cached<QPair<uchar, QVector<openrazer::DPI>>>("state/dpi/stages", [=]() { return device()->getDPIStages(); });
+}
+
+void DeviceModel::setDPIStages(uchar activeStage, const QVector<openrazer::DPI> &dpiStages)
+{
+    run([=]() { device()->setDPIStages(activeStage, dpiStages); });
+    store<QPair<uchar, QVector<openrazer::DPI>>>("state/dpi/stages", { activeStage, dpiStages });
+    invalidate("state/dpi/current");
+}
+
+ushort DeviceModel::pollRate()
+{
+    return cached<ushort>("state/pollRate", [=]() { return device()->getPollRate(); });
+}
+
+void DeviceModel::setPollRate(ushort pollRate)
+{
+    run([=]() { device()->setPollRate(pollRate); });
+    store<ushort>("state/pollRate", pollRate);
+}
+
+ushort DeviceModel::idleTime()
+{
+    return cached<ushort>("state/idleTime", [=]() { return device()->getIdleTime(); });
+}
+
+void DeviceModel::setIdleTime(ushort idleTime)
+{
+    run([=]() { device()->setIdleTime(idleTime); });
+    store<ushort>("state/idleTime", idleTime);
+}
+
+ushort DeviceModel::lowBatteryThreshold()
+{
+    return cached<ushort>("state/lowBatteryThreshold", [=]() { return device()->getLowBatteryThreshold(); });
+}
+
+void DeviceModel::setLowBatteryThreshold(ushort threshold)
+{
+    run([=]() { device()->setLowBatteryThreshold(threshold); });
+    store<ushort>("state/lowBatteryThreshold", threshold);
+}
+
+double DeviceModel::batteryPercent()
+{
+    return cached<double>("state/batteryPercent", [=]() { return device()->getBatteryPercent(); }, BATTERY_MAX_AGE_MS);
+}
+
+bool DeviceModel::isCharging()
+{
+    return cached<bool>("state/charging", [=]() { return device()->isCharging(); }, BATTERY_MAX_AGE_MS);
+}
+
+quint64 DeviceModel::cacheHits() const
+{
+    QMutexLocker locker(&mutex);
+    return hits;
+}
+
+quint64 DeviceModel::cacheMisses() const
+{
+    QMutexLocker locker(&mutex);
+    return misses;
+}
+
+void DeviceModel::invalidateState()
+{
+    invalidate("state/");
+}
@@ -0,0 +1,190 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DEVICEMODEL_H
+#define DEVICEMODEL_H
+
+#include "devicecommandqueue.h"
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <any>
+#include <functional>
+#include <libopenrazer.h>
+
+/*
+ * Caching layer in front of a libopenrazer::Device, so building pages and
+ * dialogs doesn't pay a D-Bus round trip for values that are already known.
+ *
+ * Properties which can't change while the device is connected (name, type,
+ * features, ...) are fetched once. Device state (brightness, effect, DPI,
+ * ...) is cached as well: the setters of this class update the cache after a
+ * successful write, and invalidateState() drops everything the daemon might
+ * have changed behind our back. Battery values additionally expire after a
+ * while, as they change on their own.
+ *
+ * The getters can be called from any thread, e.g. through util::readAsync() on
+ * readPool(). Like the libopenrazer calls they throw
+ * libopenrazer::DBusException; failed reads don't get cached.
+ *
+ * When the daemon restarts, the model can be rebound to the new device object
+ * so the widgets using it keep working. The effects and brightness applied
+ * through the model get applied to the new device again.
+ *
+ * Writes driven by sliders and the like should go through commandQueue(),
+ * which runs them off the GUI thread and skips outdated values.
+ *
+ * All writes to the device run on a thread of the model, one at a time.
+ * Reads don't change anything on the device, so they run on threads of
+ * their own next to each other and don't wait behind writes. Either way the
+ * caller waits for at most a few seconds; a call which hasn't started by
+ * then is dropped. After several calls in a row timed out, e.g. because
+ * a wireless device is asleep, the device is considered unresponsive: calls
+ * fail right away until a probe in the background gets a reply again. So a
+ * single device can't stall the whole application.
+ *
+ * The model owns the device.
+ */
+class DeviceModel : public QObject
+{
+    Q_OBJECT
+public:
+    DeviceModel(libopenrazer::Device *device, QObject *parent = nullptr);
+    ~DeviceModel() override;
+
+    /* Don't hold on to the pointer, it changes when the model gets rebound.
+     * Calls to the device should go through callDevice(). */
+    libopenrazer::Device *device() const;
+    /* For calls which don't go through the cache. Runs fn with the device
+     * like the getters and setters do, see below. */
+    void callDevice(const std::function<void(libopenrazer::Device *)> &fn);
+
+    /* Replace the device, e.g. after the daemon got restarted. Drops the
+     * whole cache and restores the lighting on the new device. */
+    void rebind(libopenrazer::Device *device);
+
+    DeviceCommandQueue *commandQueue();
+
+    /* For reading from the model in the background. Deleting the model waits
+     * for the reads running there, so they can use the model and device. */
+    QThreadPool *readPool();
+
+    /* False while calls fail right away because the device didn't respond */
+    bool isResponsive() const;
+
+    /* Fixed while the device is connected */
+    QDBusObjectPath objectPath();
+    QString name();
+    QString type();
+    bool hasFeature(const QString &feature);
+    QVector<libopenrazer::Led *> leds();
+    libopenrazer::Led *led(openrazer::LedId ledId);
+    QString imageUrl();
+    openrazer::MatrixDimensions matrixDimensions();
+    QString keyboardLayout();
+    QString serial();
+    QString firmwareVersion();
+    int maxDPI();
+    QVector<ushort> allowedDPI();
+    QVector<ushort> supportedPollRates();
+
+    /* Device state */
+    uchar brightness(openrazer::LedId ledId);
+    void setBrightness(openrazer::LedId ledId, uchar brightness);
+    /* Call apply with the LED and remember it for restoring the effect */
+    void applyEffect(openrazer::LedId ledId, const std::function<void(libopenrazer::Led *)> &apply);
+    openrazer::Effect currentEffect(openrazer::LedId ledId);
+    QVector<openrazer::RGB> currentColors(openrazer::LedId ledId);
+    /* Applying an effect can change the effect and colors of all LEDs, e.g.
+     * with effect sync enabled */
+    void invalidateEffects();
+
+    openrazer::DPI dpi();
+    void setDPI(openrazer::DPI dpi);
+    QPair<uchar, QVector<openrazer::DPI>> dpiStages();
+    void setDPIStages(uchar activeStage, const QVector<openrazer::DPI> &dpiStages);
+    ushort pollRate();
+    void setPollRate(ushort pollRate);
+
+    ushort idleTime();
+    void setIdleTime(ushort idleTime);
+    ushort lowBatteryThreshold();
+    void setLowBatteryThreshold(ushort threshold);
+    double batteryPercent();
+    bool isCharging();
+
+    /* Reads answered from the cache and reads which had to ask the device */
+    quint64 cacheHits() const;
+    quint64 cacheMisses() const;
+
+public slots:
+    /* Forget all cached device state, keeps the fixed properties */
+    void invalidateState();
+
+signals:
+    /* The model now uses a different device */
+    void rebound();
+    void responsiveChanged(bool responsive);
+
+private:
+    struct Entry {
+        std::any value;
+        QDeadlineTimer expiry = QDeadlineTimer(QDeadlineTimer::Forever);
+    };
+
+    template<typename T>
+    T cached(const QString &key, const std::function<T()> &fetch, qint64 maxAgeMs = -1);
+    template<typename T>
+    void store(const QString &key, const T &value);
+    void invalidate(const QString &prefix);
+
+    /* Run fn on the call thread, or on threads, and wait for it, see above */
+    void run(const std::function<void()> &fn);
+    void run(const std::function<void()> &fn, QThreadPool *threads);
+    template<typename T>
+    T call(const std::function<T()> &fn);
+    void callCompleted();
+    void callTimedOut();
+    void probe();
+    void setResponsive(bool responsive);
+
+    struct LedSnapshot {
+        std::function<void(libopenrazer::Led *)> effect;
+        int brightness = -1;
+    };
+
+    libopenrazer::Device *mDevice;
+    DeviceCommandQueue *commands;
+
+    /* Runs the writes to the device */
+    QThreadPool callThread;
+    /* Runs the reads from the device which missed the cache */
+    QThreadPool fetchThreads;
+    /* Runs the reads of the widgets, see readPool() */
+    QThreadPool readThreads;
+    QTimer *probeTimer;
+    /* Devices replaced by rebind(), reads might still be running on them */
+    QVector<libopenrazer::Device *> retiredDevices;
+
+    mutable QMutex mutex;
+    QHash<QString, Entry> cache;
+    /* Incremented whenever cached values get outdated, e.g. by a write or
+     * rebind(), so values read before that don't end up in the cache */
+    int generation = 0;
+    /* By LED id, last lighting applied through the model */
+    QHash<int, LedSnapshot> ledSnapshots;
+    quint64 hits = 0;
+    quint64 misses = 0;
+
+    /* Circuit breaker */
+    int consecutiveTimeouts = 0;
+    bool responsive = true;
+    bool probeRunning = false;
+};
+
+#endif // DEVICEMODEL_H
@@ -19,7 +19,7 @@
 #include <QTimer>
 #include <QVBoxLayout>
 
-DeviceWidget::DeviceWidget(libopenrazer::Device *device)
+DeviceWidget::DeviceWidget(DeviceModel *model)
     : QWidget()
 {
     auto *verticalLayout = new QVBoxLayout(this);
@@ -29,11 +29,11 @@ DeviceWidget::DeviceWidget(libopenrazer::Device *device)
     /* Header items */
     auto *headerHBox = new QHBoxLayout();
 
-    QLabel *header = new QLabel(device->getDeviceName(), this);
+    QLabel *header = new QLabel(model->name(), this);
     header->setFont(titleFont);
     headerHBox->addWidget(header);
 
-    if (QStringList({ "keyboard", "keypad", "mouse" }).contains(device->getDeviceType())) {
+    if (QStringList({ "keyboard", "keypad", "mouse" }).contains(model->type())) {
         QPushButton *remapButton = new QPushButton();
         remapButton->setText(tr("Input remapping"));
         remapButton->setSizePolicy(QSizePolicy(QSizePolicy::Maximum, QSizePolicy::Fixed));
@@ -66,7 +66,7 @@ DeviceWidget::DeviceWidget(libopenrazer::Device *device)
     infoButton->setSizePolicy(QSizePolicy(QSizePolicy::Maximum, QSizePolicy::Fixed));
     infoButton->setIcon(QIcon::fromTheme("help-about-symbolic"));
     connect(infoButton, &QPushButton::clicked, this, [=]() {
-        auto *info = new DeviceInfoDialog(device, this);
+        auto *info = new DeviceInfoDialog(model, this);
         info->setWindowModality(Qt::WindowModal);
         info->setAttribute(Qt::WA_DeleteOnClose);
         info->show();
@@ -75,43 +75,90 @@ DeviceWidget::DeviceWidget(libopenrazer::Device *device)
 
     verticalLayout->addLayout(headerHBox);
 
-    /* Tabs */
+    /* Tabs, the contents get built when a tab is shown for the first time */
     QTabWidget *tabWidget = new QTabWidget(this);
 
     /* Lighting tab */
-    if (LightingWidget::isAvailable(device)) {
-        auto widget = new LightingWidget(device);
-
-        auto scrollArea = new QScrollArea;
-        scrollArea->setWidgetResizable(true);
-        scrollArea->setWidget(widget);
-
-        tabWidget->addTab(scrollArea, tr("Lighting"));
+    if (LightingWidget::isAvailable(model)) {
+        addLazyTab(tabWidget, tr("Lighting"), [=]() { return new LightingWidget(model); });
     }
 
     /* Performance tab */
-    if (PerformanceWidget::isAvailable(device)) {
-        auto widget = new PerformanceWidget(device);
-
-        auto scrollArea = new QScrollArea;
-        scrollArea->setWidgetResizable(true);
-        scrollArea->setWidget(widget);
-
-        tabWidget->addTab(scrollArea, tr("Performance"));
+    if (PerformanceWidget::isAvailable(model)) {
+        addLazyTab(tabWidget, tr("Performance"), [=]() { return new PerformanceWidget(model); });
     }
 
     /* Power tab */
-    if (PowerWidget::isAvailable(device)) {
-        auto widget = new PowerWidget(device);
-
-        auto scrollArea = new QScrollArea;
-        scrollArea->setWidgetResizable(true);
-        scrollArea->setWidget(widget);
-
-        tabWidget->addTab(scrollArea, tr("Power"));
+    if (PowerWidget::isAvailable(model)) {
+        addLazyTab(tabWidget, tr("Power"), [=]() { return new PowerWidget(model); });
     }
 
+    connect(tabWidget, &QTabWidget::currentChanged, this, [=](int index) {
+        buildTab(qobject_cast<QScrollArea *>(tabWidget->widget(index)));
+    });
+    buildTab(qobject_cast<QScrollArea *>(tabWidget->currentWidget()));
+
     verticalLayout->addWidget(tabWidget);
 }
 
 DeviceWidget::~DeviceWidget() = default;
+
+void DeviceWidget::preload(DeviceModel *model)
+{
+    model->name();
+    model->type();
+    for (libopenrazer::Led *led : model->leds())
+        model->led(led->getLedId());
+
+    const QStringList features = { "battery", "custom_frame", "dpi", "dpi_stages", "idle_time",
+                                   "low_battery_threshold", "poll_rate", "restricted_dpi" };
+    for (const QString &feature : features)
+        model->hasFeature(feature);
+
+    if (model->hasFeature("custom_frame")) {
+        model->matrixDimensions();
+        model->objectPath();
+        if (model->type() == "keyboard")
+            model->keyboardLayout();
+    }
+    if (model->hasFeature("restricted_dpi"))
+        model->allowedDPI();
+}
+
+/*
+ * Whether the page is doing something the user would notice when it's torn
+ * down, e.g. sending custom frames to the device.
+ */
+bool DeviceWidget::isInUse() const
+{
+    for (LightingWidget *widget : findChildren<LightingWidget *>()) {
+        if (widget->isInUse())
+            return true;
+    }
+    return false;
+}
+
+void DeviceWidget::addLazyTab(QTabWidget *tabWidget, const QString &label, const std::function<QWidget *()> &build)
+{
+    auto scrollArea = new QScrollArea;
+    scrollArea->setWidgetResizable(true);
+
+    tabWidget->addTab(scrollArea, label);
+    pendingTabs.insert(scrollArea, build);
+}
+
+void DeviceWidget::buildTab(QScrollArea *scrollArea)
+{
+    auto it = pendingTabs.find(scrollArea);
+    if (it == pendingTabs.end())
+        return;
+
+    std::function<QWidget *()> build = it.value();
+    pendingTabs.erase(it);
+    try {
+        scrollArea->setWidget(build());
+    } catch (const libopenrazer::DBusException &e) {
+        qWarning("Failed to build device tab");
+        scrollArea->setWidget(new QLabel(tr("The device didn't respond."), scrollArea));
+    }
+}
@@ -5,16 +5,34 @@
 #ifndef DEVICEWIDGET_H
 #define DEVICEWIDGET_H
 
+#include "devicemodel.h"
+
 #include <QDBusObjectPath>
+#include <QScrollArea>
+#include <QTabWidget>
 #include <QWidget>
-#include <libopenrazer.h>
+#include <functional>
 
 class DeviceWidget : public QWidget
 {
     Q_OBJECT
 public:
-    DeviceWidget(libopenrazer::Device *device);
+    DeviceWidget(DeviceModel *model);
     ~DeviceWidget() override;
+
+    /* Read what building the widget and its tabs needs into the cache of
+     * model, so building it doesn't wait for the device. Blocks, run it on
+     * the read pool of the model. Throws libopenrazer::DBusException. */
+    static void preload(DeviceModel *model);
+
+    bool isInUse() const;
+
+private:
+    void addLazyTab(QTabWidget *tabWidget, const QString &label, const std::function<QWidget *()> &build);
+    void buildTab(QScrollArea *scrollArea);
+
+    /* Tabs which haven't been shown yet */
+    QHash<QScrollArea *, std::function<QWidget *()>> pendingTabs;
 };
 
 #endif // DEVICEWIDGET_H
@@ -10,10 +10,10 @@
 #include <QLabel>
 #include <QVBoxLayout>
 
-DpiComboBoxWidget::DpiComboBoxWidget(QWidget *parent, libopenrazer::Device *device)
+DpiComboBoxWidget::DpiComboBoxWidget(QWidget *parent, DeviceModel *model)
     : QWidget(parent)
 {
-    this->device = device;
+    this->model = model;
 
     QVBoxLayout *verticalLayout = new QVBoxLayout(this);
 
@@ -25,14 +25,14 @@ DpiComboBoxWidget::DpiComboBoxWidget(QWidget *parent, libopenrazer::Device *devi
     verticalLayout->addWidget(dpiHeader);
 
     QComboBox *dpiComboBox = new QComboBox;
-    QVector<ushort> allowedDPI = device->getAllowedDPI();
+    QVector<ushort> allowedDPI = model->allowedDPI();
     for (ushort dpi : allowedDPI) {
         dpiComboBox->addItem(QString("%1 DPI").arg(dpi), dpi);
     }
 
     openrazer::DPI currDPI = { 0, 0 };
     try {
-        currDPI = device->getDPI();
+        currDPI = model->dpi();
     } catch (const libopenrazer::DBusException &e) {
         qWarning("Failed to get dpi");
     }
@@ -47,7 +47,7 @@ void DpiComboBoxWidget::dpiChanged(int /* index */)
 {
     auto *sender = qobject_cast<QComboBox *>(QObject::sender());
     try {
-        device->setDPI({ sender->currentData().value<ushort>(), 0 });
+        model->setDPI({ sender->currentData().value<ushort>(), 0 });
     } catch (const libopenrazer::DBusException &e) {
         qWarning("Failed to set DPI");
         util::showError(tr("Failed to set DPI"));
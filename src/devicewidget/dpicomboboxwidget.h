@@ -5,20 +5,21 @@
 #ifndef DPICOMBOBOXWIDGET_H
 #define DPICOMBOBOXWIDGET_H
 
+#include "devicemodel.h"
+
 #include <QWidget>
-#include <libopenrazer.h>
 
 class DpiComboBoxWidget : public QWidget
 {
     Q_OBJECT
 public:
-    DpiComboBoxWidget(QWidget *parent, libopenrazer::Device *device);
+    DpiComboBoxWidget(QWidget *parent, DeviceModel *model);
 
 public slots:
     void dpiChanged(int /* value */);
 
 private:
-    libopenrazer::Device *device;
+    DeviceModel *model;
 };
 
 #endif // DPICOMBOBOXWIDGET_H
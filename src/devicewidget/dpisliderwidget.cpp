@@ -4,6 +4,7 @@
 
 #include "dpisliderwidget.h"
 
+#include "asyncread.h"
 #include "util.h"
 
 #include <QCheckBox>
@@ -14,10 +15,29 @@
 #include <QSlider>
 #include <QSpinBox>
 
-DpiSliderWidget::DpiSliderWidget(QWidget *parent, libopenrazer::Device *device)
+/* Time without changes after which the DPI gets written to the device */
+#define DPI_COMMIT_DELAY_MS (150)
+
+static bool sameStages(const QVector<openrazer::DPI> &a, const QVector<openrazer::DPI> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (int i = 0; i < a.size(); i++) {
+        if (a[i].dpi_x != b[i].dpi_x || a[i].dpi_y != b[i].dpi_y)
+            return false;
+    }
+    return true;
+}
+
+DpiSliderWidget::DpiSliderWidget(QWidget *parent, DeviceModel *model)
     : QWidget(parent)
 {
-    this->device = device;
+    this->model = model;
+
+    commitTimer = new QTimer(this);
+    commitTimer->setSingleShot(true);
+    commitTimer->setInterval(DPI_COMMIT_DELAY_MS);
+    connect(commitTimer, &QTimer::timeout, this, &DpiSliderWidget::commit);
 
     // The widget seems to get big spacing in some cases without this size policy
     setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed));
@@ -35,7 +55,7 @@ DpiSliderWidget::DpiSliderWidget(QWidget *parent, libopenrazer::Device *device)
 
     dpiHeaderHBox->addItem(new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum));
 
-    if (device->hasFeature("dpi_stages")) {
+    if (model->hasFeature("dpi_stages")) {
         auto *dpiStagesCheckbox = new QCheckBox();
         dpiStagesCheckbox->setText(tr("Enable stages"));
         dpiStagesCheckbox->setChecked(true); // TODO: determine based on something
@@ -52,13 +72,14 @@ DpiSliderWidget::DpiSliderWidget(QWidget *parent, libopenrazer::Device *device)
                 }
             }
 
-            dpiStageWidgets[0]->setSingleStage(!checked);
             singleStage = !checked;
+            dpiStageWidgets[0]->setSingleStage(!checked);
+            scheduleCommit();
         });
     }
 
     // Sync checkbox
-    auto *dpiSyncCheckbox = new QCheckBox();
+    dpiSyncCheckbox = new QCheckBox();
     dpiSyncCheckbox->setText(tr("Lock X/Y"));
     dpiHeaderHBox->addWidget(dpiSyncCheckbox);
     verticalLayout->addLayout(dpiHeaderHBox);
@@ -72,41 +93,15 @@ DpiSliderWidget::DpiSliderWidget(QWidget *parent, libopenrazer::Device *device)
     // DPI stages
     const int minimumDpi = 100;
 
-    int maximumDpi = 0;
-    try {
-        maximumDpi = device->maxDPI();
-    } catch (const libopenrazer::DBusException &e) {
-        qWarning("Failed to get max dpi");
-    }
-
-    if (device->hasFeature("dpi_stages")) {
-        QPair<uchar, QVector<openrazer::DPI>> stagesPair = { 1, {} };
-        try {
-            stagesPair = device->getDPIStages();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get dpi stages");
-        }
-        activeStage = stagesPair.first;
-        dpiStages = stagesPair.second;
-
-        // Assume user wants DPI synced if all values are currently equal
-        bool isSynced = true;
-        for (openrazer::DPI dpi : dpiStages) {
-            isSynced &= dpi.dpi_x == dpi.dpi_y;
-        }
-        dpiSyncCheckbox->setChecked(isSynced);
+    // Can't change anything before knowing the current state
+    setEnabled(false);
 
-        /* Create widgets for the 5 possible DPI stages */
+    if (model->hasFeature("dpi_stages")) {
+        /* Create widgets for the 5 possible DPI stages, filled in once the
+         * stages have been read */
         for (int stageNumber = 1; stageNumber <= 5; stageNumber++) {
-            /* Makes sure we have a DPI stage for every value - 0/0 if not provided */
-            if (dpiStages.size() < stageNumber) {
-                dpiStages.append({ 0, 0 });
-            }
-            /* Get DPI for current stage */
-            openrazer::DPI dpi = dpiStages[stageNumber - 1];
-
-            auto *stageWidget = new DpiStageWidget(stageNumber, minimumDpi, maximumDpi, dpi, activeStage == stageNumber);
-            stageWidget->setSyncDpi(isSynced);
+            auto *stageWidget = new DpiStageWidget(stageNumber, minimumDpi, minimumDpi, { 0, 0 }, false);
+            stageWidget->setSyncDpi(false);
 
             connect(stageWidget, &DpiStageWidget::stageActivated, this, [=](int stageNumber) {
                 activeStage = stageNumber;
@@ -114,58 +109,118 @@ DpiSliderWidget::DpiSliderWidget(QWidget *parent, libopenrazer::Device *device)
                     widget->informStageActive(activeStage);
                 }
 
-                device->setDPIStages(activeStage, dpiStages);
+                // Switching stages is a single click, no need to wait
+                commit();
             });
 
             connect(stageWidget, &DpiStageWidget::dpiChanged, this, [=](int stageNumber, openrazer::DPI dpi) {
                 handleStageUpdates();
 
-                /* Apply to device */
-                if (singleStage) {
-                    device->setDPI(dpi);
-                } else {
-                    /* If the currently active stage was disabled, we need to
-                     * find a new one to enable */
-                    if (dpi.dpi_x == 0 && dpi.dpi_y == 0 && stageNumber == activeStage) {
-                        activeStage = 1;
-                        for (DpiStageWidget *widget : dpiStageWidgets) {
-                            widget->informStageActive(activeStage);
-                        }
+                /* If the currently active stage was disabled, we need to
+                 * find a new one to enable */
+                if (!singleStage && dpi.dpi_x == 0 && dpi.dpi_y == 0 && stageNumber == activeStage) {
+                    activeStage = 1;
+                    for (DpiStageWidget *widget : dpiStageWidgets) {
+                        widget->informStageActive(activeStage);
                     }
-
-                    device->setDPIStages(activeStage, dpiStages);
                 }
+
+                scheduleCommit();
             });
+            connect(stageWidget, &DpiStageWidget::editingFinished, this, &DpiSliderWidget::commit);
 
             verticalLayout->addWidget(stageWidget);
 
             dpiStageWidgets.append(stageWidget);
         }
 
-        handleStageUpdates();
+        util::readAsync<QPair<uchar, QVector<openrazer::DPI>>>(
+                model->readPool(), this, [=]() { return model->dpiStages(); }, { 1, {} }, "Failed to get dpi stages",
+                [=](const QPair<uchar, QVector<openrazer::DPI>> &stagesPair) {
+                    activeStage = stagesPair.first;
+                    dpiStages = stagesPair.second;
+                    confirmedActiveStage = activeStage;
+                    confirmedStages = dpiStages;
+                    confirmedValid = true;
+                    readFinished();
+                });
     } else {
-        openrazer::DPI currentDpi = { 0, 0 };
-        try {
-            currentDpi = device->getDPI();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get dpi");
-        }
-
-        // Assume user wants DPI synced if both values are currently equal
-        bool isSynced = currentDpi.dpi_x == currentDpi.dpi_y;
-        dpiSyncCheckbox->setChecked(isSynced);
-
-        auto *stageWidget = new DpiStageWidget(0, minimumDpi, maximumDpi, currentDpi, false);
+        auto *stageWidget = new DpiStageWidget(0, minimumDpi, minimumDpi, { 0, 0 }, false);
         stageWidget->setSingleStage(true);
-        stageWidget->setSyncDpi(isSynced);
-        connect(stageWidget, &DpiStageWidget::dpiChanged, this, [=](int /*stageNumber*/, openrazer::DPI dpi) {
-            device->setDPI(dpi);
-        });
+        stageWidget->setSyncDpi(false);
+        connect(stageWidget, &DpiStageWidget::dpiChanged, this, &DpiSliderWidget::scheduleCommit);
+        connect(stageWidget, &DpiStageWidget::editingFinished, this, &DpiSliderWidget::commit);
 
         verticalLayout->addWidget(stageWidget);
 
         dpiStageWidgets.append(stageWidget);
+
+        util::readAsync<openrazer::DPI>(
+                model->readPool(), this, [=]() { return model->dpi(); }, { 0, 0 }, "Failed to get dpi",
+                [=](const openrazer::DPI &currentDpi) {
+                    dpiStages = { currentDpi };
+                    confirmedStages = dpiStages;
+                    confirmedValid = true;
+                    readFinished();
+                });
     }
+
+    util::readAsync<int>(
+            model->readPool(), this, [=]() { return model->maxDPI(); }, 0, "Failed to get max dpi",
+            [=](const int &dpi) {
+                maximumDpi = dpi;
+                readFinished();
+            });
+}
+
+void DpiSliderWidget::hideEvent(QHideEvent *event)
+{
+    // Don't lose the last change when the page gets switched away from or
+    // closed right away; this runs before the page and the model get deleted
+    if (commitTimer->isActive())
+        commit();
+    QWidget::hideEvent(event);
+}
+
+/*
+ * Called for each of the reads issued in the constructor, shows the state of
+ * the device once all of them have finished.
+ */
+void DpiSliderWidget::readFinished()
+{
+    if (--pendingReads > 0)
+        return;
+
+    // Assume user wants DPI synced if all values are currently equal
+    bool isSynced = true;
+    for (openrazer::DPI dpi : std::as_const(dpiStages)) {
+        isSynced &= dpi.dpi_x == dpi.dpi_y;
+    }
+    dpiSyncCheckbox->setChecked(isSynced);
+
+    if (model->hasFeature("dpi_stages")) {
+        for (int stageNumber = 1; stageNumber <= dpiStageWidgets.size(); stageNumber++) {
+            /* Makes sure we have a DPI stage for every value - 0/0 if not provided */
+            if (dpiStages.size() < stageNumber) {
+                dpiStages.append({ 0, 0 });
+            }
+
+            DpiStageWidget *stageWidget = dpiStageWidgets[stageNumber - 1];
+            stageWidget->setMaximumDpi(maximumDpi);
+            stageWidget->setDpi(dpiStages[stageNumber - 1]);
+            stageWidget->informStageActive(activeStage);
+            stageWidget->setSyncDpi(isSynced);
+        }
+
+        handleStageUpdates();
+    } else {
+        DpiStageWidget *stageWidget = dpiStageWidgets[0];
+        stageWidget->setMaximumDpi(maximumDpi);
+        stageWidget->setDpi(dpiStages[0]);
+        stageWidget->setSyncDpi(isSynced);
+    }
+
+    setEnabled(true);
 }
 
 void DpiSliderWidget::handleStageUpdates()
@@ -198,3 +253,54 @@ void DpiSliderWidget::handleStageUpdates()
         stageWidget->informLastStage(lastStage);
     }
 }
+
+void DpiSliderWidget::scheduleCommit()
+{
+    // Restarts the timer, so a drag only gets written once it pauses
+    commitTimer->start();
+}
+
+/*
+ * Write the DPI settings shown in the widget to the device, unless that's
+ * what the device has been set to already.
+ */
+void DpiSliderWidget::commit()
+{
+    commitTimer->stop();
+
+    // Nothing has been shown yet, so nothing can have been changed
+    if (pendingReads > 0)
+        return;
+
+    if (singleStage) {
+        openrazer::DPI dpi = dpiStageWidgets[0]->getDpi();
+        if (confirmedValid && sameStages(confirmedStages, { dpi }))
+            return;
+
+        confirmedStages = { dpi };
+        confirmedValid = true;
+        model->commandQueue()->submit(
+                "dpi", [=]() { model->setDPI(dpi); }, this,
+                [=]() {
+                    confirmedValid = false;
+                    qWarning("Failed to set DPI");
+                    util::showError(tr("Failed to set DPI"));
+                });
+    } else {
+        uchar stage = activeStage;
+        QVector<openrazer::DPI> stages = dpiStages;
+        if (confirmedValid && confirmedActiveStage == stage && sameStages(confirmedStages, stages))
+            return;
+
+        confirmedActiveStage = stage;
+        confirmedStages = stages;
+        confirmedValid = true;
+        model->commandQueue()->submit(
+                "dpi", [=]() { model->setDPIStages(stage, stages); }, this,
+                [=]() {
+                    confirmedValid = false;
+                    qWarning("Failed to set DPI stages");
+                    util::showError(tr("Failed to set DPI stages"));
+                });
+    }
+}
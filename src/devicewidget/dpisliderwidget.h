@@ -5,31 +5,57 @@
 #ifndef DPISLIDERWIDGET_H
 #define DPISLIDERWIDGET_H
 
+#include "devicemodel.h"
 #include "dpistagewidget.h"
 
+#include <QCheckBox>
 #include <QLabel>
 #include <QSlider>
 #include <QSpinBox>
+#include <QTimer>
 #include <QWidget>
-#include <libopenrazer.h>
 
+/*
+ * Edits the DPI stages of a device. All changes the user makes in one go
+ * (dragging a slider, Lock X/Y changing both axes, ...) are collected and
+ * written to the device once they settle, and only if they differ from what
+ * the device has been set to last.
+ */
 class DpiSliderWidget : public QWidget
 {
     Q_OBJECT
 public:
-    DpiSliderWidget(QWidget *parent, libopenrazer::Device *device);
+    DpiSliderWidget(QWidget *parent, DeviceModel *model);
+
+protected:
+    void hideEvent(QHideEvent *event) override;
 
 private:
-    libopenrazer::Device *device;
+    DeviceModel *model;
 
-    bool singleStage;
+    bool singleStage = true;
 
     uchar activeStage;
     QVector<openrazer::DPI> dpiStages;
 
     QVector<DpiStageWidget *> dpiStageWidgets;
+    QCheckBox *dpiSyncCheckbox;
+
+    /* maxDPI and getDPIStages/getDPI */
+    int pendingReads = 2;
+    int maximumDpi = 0;
+
+    /* Last state read from or written to the device */
+    bool confirmedValid = false;
+    uchar confirmedActiveStage = 0;
+    QVector<openrazer::DPI> confirmedStages;
+
+    QTimer *commitTimer;
 
+    void readFinished();
     void handleStageUpdates();
+    void scheduleCommit();
+    void commit();
 };
 
 #endif // DPISLIDERWIDGET_H
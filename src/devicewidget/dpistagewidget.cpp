@@ -105,6 +105,9 @@ DpiStageWidget::DpiStageWidget(int initialStageNumber, int minimumDpi, int maxim
         dpiYSpinBox->setValue(sliderValue * DPI_STEP_SIZE);
     });
 
+    connect(dpiXSlider, &QSlider::sliderReleased, this, &DpiStageWidget::editingFinished);
+    connect(dpiYSlider, &QSlider::sliderReleased, this, &DpiStageWidget::editingFinished);
+
     connect(dpiXSpinBox, &QSpinBox::valueChanged, this, [=](int spinboxValue) {
         if (syncDpi) {
             dpiYSpinBox->setValue(spinboxValue);
@@ -170,6 +173,7 @@ void DpiStageWidget::setSyncDpi(bool syncDpi)
 
 void DpiStageWidget::setSingleStage(bool singleStage)
 {
+    this->singleStage = singleStage;
     if (singleStage) {
         dpiStageButton->hide();
         enableCheckBox->hide();
@@ -182,6 +186,37 @@ void DpiStageWidget::setSingleStage(bool singleStage)
     }
 }
 
+void DpiStageWidget::setDpi(openrazer::DPI dpi)
+{
+    QSignalBlocker xSpinBoxBlocker(dpiXSpinBox);
+    QSignalBlocker ySpinBoxBlocker(dpiYSpinBox);
+    QSignalBlocker xSliderBlocker(dpiXSlider);
+    QSignalBlocker ySliderBlocker(dpiYSlider);
+
+    dpiXSpinBox->setValue(dpi.dpi_x);
+    dpiYSpinBox->setValue(dpi.dpi_y);
+    dpiXSlider->setValue(dpi.dpi_x / DPI_STEP_SIZE);
+    dpiYSlider->setValue(dpi.dpi_y / DPI_STEP_SIZE);
+
+    // A single stage is always enabled
+    bool enabled = singleStage || dpi.dpi_x != 0;
+    enableCheckBox->setChecked(enabled);
+    updateEnabled(enabled);
+}
+
+void DpiStageWidget::setMaximumDpi(int maximumDpi)
+{
+    QSignalBlocker xSpinBoxBlocker(dpiXSpinBox);
+    QSignalBlocker ySpinBoxBlocker(dpiYSpinBox);
+    QSignalBlocker xSliderBlocker(dpiXSlider);
+    QSignalBlocker ySliderBlocker(dpiYSlider);
+
+    dpiXSpinBox->setMaximum(maximumDpi);
+    dpiYSpinBox->setMaximum(maximumDpi);
+    dpiXSlider->setMaximum(maximumDpi / DPI_STEP_SIZE);
+    dpiYSlider->setMaximum(maximumDpi / DPI_STEP_SIZE);
+}
+
 void DpiStageWidget::informStageActive(int activeStage)
 {
     dpiStageButton->setChecked(activeStage == stageNumber && dpiStageButton->isEnabled());
@@ -23,6 +23,10 @@ public:
     void setSyncDpi(bool syncDpi);
     /* Tell the stage that it's being used as single-stage DPI widget */
     void setSingleStage(bool singleStage);
+    /* Show the DPI and range read from the device, without emitting
+     * dpiChanged */
+    void setDpi(openrazer::DPI dpi);
+    void setMaximumDpi(int maximumDpi);
     /* Inform the stage which stage should be active */
     void informStageActive(int activeStage);
     /* Inform the stage that it's the last one that's active and needs to
@@ -41,6 +45,8 @@ signals:
     void dpiChanged(int stageNumber, openrazer::DPI dpi);
     /* This stage has been activated */
     void stageActivated(int stageNumber);
+    /* The user let go of a slider, the DPI won't change any further for now */
+    void editingFinished();
 
 private:
     QPushButton *dpiStageButton;
@@ -54,6 +60,7 @@ private:
     QSlider *dpiYSlider;
 
     bool syncDpi;
+    bool singleStage = false;
     int stageNumber;
 
     void emitDpiChanged();
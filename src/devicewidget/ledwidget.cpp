@@ -4,6 +4,7 @@
 
 #include "ledwidget.h"
 
+#include "asyncread.h"
 #include "util.h"
 
 #include <QApplication>
@@ -13,17 +14,22 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QRadioButton>
+#include <QSharedPointer>
+#include <functional>
 #include <stdexcept>
 
-LedWidget::LedWidget(QWidget *parent, libopenrazer::Led *led)
+LedWidget::LedWidget(QWidget *parent, DeviceModel *model, openrazer::LedId ledId)
     : QWidget(parent)
 {
-    this->mLed = led;
+    this->model = model;
+    this->ledId = ledId;
+
+    libopenrazer::Led *led = model->led(ledId);
 
     auto *verticalLayout = new QVBoxLayout(this);
 
     // Set appropriate text
-    QString lightingLocation = qApp->translate("libopenrazer", libopenrazer::ledIdToStringTable.value(led->getLedId(), "error"));
+    QString lightingLocation = qApp->translate("libopenrazer", libopenrazer::ledIdToStringTable.value(ledId, "error"));
     QLabel *lightingLocationLabel = new QLabel(tr("Effect %1").arg(lightingLocation));
 
     auto *lightingHBox = new QHBoxLayout();
@@ -37,27 +43,10 @@ LedWidget::LedWidget(QWidget *parent, libopenrazer::Led *led)
 
     // TODO Sync effects in comboboxes & colorStuff when the sync checkbox is active
 
-    openrazer::Effect currentEffect = openrazer::Effect::Static;
-    try {
-        currentEffect = led->getCurrentEffect();
-    } catch (const libopenrazer::DBusException &e) {
-        qWarning("Failed to get current effect");
-    }
-    QVector<openrazer::RGB> currentColors;
-    try {
-        currentColors = led->getCurrentColors();
-    } catch (const libopenrazer::DBusException &e) {
-        qWarning("Failed to get current colors");
-    }
-
-    // Add items from capabilities
+    // Add items from capabilities, the current effect gets selected once it has been read
     for (auto ledFx : libopenrazer::ledFxList) {
         if (led->hasFx(ledFx.getIdentifier())) {
             comboBox->addItem(qApp->translate("libopenrazer", ledFx.getDisplayString()), QVariant::fromValue(ledFx));
-            // Set selection to current effect
-            if (ledFx.getIdentifier() == currentEffect) {
-                comboBox->setCurrentIndex(comboBox->count() - 1);
-            }
         }
     }
 
@@ -72,12 +61,7 @@ LedWidget::LedWidget(QWidget *parent, libopenrazer::Led *led)
         for (int i = 1; i <= 3; i++) {
             auto *colorButton = new QPushButton(this);
             QPalette pal = colorButton->palette();
-            if (i - 1 < currentColors.count()) {
-                openrazer::RGB color = currentColors.at(i - 1);
-                pal.setColor(QPalette::Button, { color.r, color.g, color.b });
-            } else {
-                pal.setColor(QPalette::Button, QColor(Qt::green));
-            }
+            pal.setColor(QPalette::Button, QColor(Qt::green));
 
             colorButton->setAutoFillBackground(true);
             colorButton->setFlat(true);
@@ -86,9 +70,6 @@ LedWidget::LedWidget(QWidget *parent, libopenrazer::Led *led)
             colorButton->setObjectName("colorbutton" + QString::number(i));
             lightingHBox->addWidget(colorButton);
 
-            libopenrazer::Capability capability = comboBox->currentData().value<libopenrazer::Capability>();
-            if (capability.getNumColors() < i)
-                colorButton->hide();
             connect(colorButton, &QPushButton::clicked, this, &LedWidget::colorButtonClicked);
         }
 
@@ -105,16 +86,60 @@ LedWidget::LedWidget(QWidget *parent, libopenrazer::Led *led)
             radio->setObjectName("radiobutton" + QString::number(i));
             if (i == 1) // set the 'left' checkbox to activated
                 radio->setChecked(true);
-            // Hide radio button when we don't need it
-            if (currentEffect != openrazer::Effect::Wave && currentEffect != openrazer::Effect::Wheel) {
-                radio->hide();
-            }
             lightingHBox->addWidget(radio);
             connect(radio, &QRadioButton::toggled, this, [=](bool enabled) {
                 if (enabled)
                     applyEffect();
             });
         }
+
+        // Show the buttons for the first effect until the current one is known
+        updateControls(comboBox->currentData().value<libopenrazer::Capability>());
+
+        // Can't change the effect before knowing the current state
+        comboBox->setEnabled(false);
+        for (int i = 1; i <= 3; i++)
+            findChild<QPushButton *>("colorbutton" + QString::number(i))->setEnabled(false);
+
+        auto pendingReads = QSharedPointer<int>::create(2);
+        auto readFinished = [=]() {
+            if (--(*pendingReads) > 0)
+                return;
+            comboBox->setEnabled(true);
+            for (int i = 1; i <= 3; i++)
+                findChild<QPushButton *>("colorbutton" + QString::number(i))->setEnabled(true);
+        };
+
+        util::readAsync<openrazer::Effect>(
+                model->readPool(), this, [=]() { return model->currentEffect(ledId); }, openrazer::Effect::Static, "Failed to get current effect",
+                [=](const openrazer::Effect &currentEffect) {
+                    // Don't override the custom editor taking over in the meantime
+                    if (comboBox->currentText() != "Custom Effect") {
+                        for (int i = 0; i < comboBox->count(); i++) {
+                            if (comboBox->itemData(i).value<libopenrazer::Capability>().getIdentifier() == currentEffect) {
+                                // Only show the current state, don't apply it again
+                                QSignalBlocker blocker(comboBox);
+                                comboBox->setCurrentIndex(i);
+                                updateControls(comboBox->itemData(i).value<libopenrazer::Capability>());
+                                break;
+                            }
+                        }
+                    }
+                    readFinished();
+                });
+
+        util::readAsync<QVector<openrazer::RGB>>(
+                model->readPool(), this, [=]() { return model->currentColors(ledId); }, {}, "Failed to get current colors",
+                [=](const QVector<openrazer::RGB> &currentColors) {
+                    for (int i = 1; i <= 3 && i - 1 < currentColors.count(); i++) {
+                        auto *colorButton = findChild<QPushButton *>("colorbutton" + QString::number(i));
+                        openrazer::RGB color = currentColors.at(i - 1);
+                        QPalette pal = colorButton->palette();
+                        pal.setColor(QPalette::Button, { color.r, color.g, color.b });
+                        colorButton->setPalette(pal);
+                    }
+                    readFinished();
+                });
     } else {
         // Otherwise delete comboBox again
         delete comboBox;
@@ -130,26 +155,30 @@ LedWidget::LedWidget(QWidget *parent, libopenrazer::Led *led)
 
         auto *brightnessSliderValue = new QLabel;
 
-        uchar brightness;
-        try {
-            brightness = led->getBrightness();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get brightness");
-            brightness = 100;
-        }
+        // Placeholder until the brightness has been read
+        brightnessSlider->setEnabled(false);
+        brightnessSliderValue->setText("…");
 
-        brightnessSlider->setValue(brightness);
-        brightnessSliderValue->setText(QString("%1%").arg(brightness * 100 / 255));
+        util::readAsync<uchar>(
+                model->readPool(), this, [=]() { return model->brightness(ledId); }, 100, "Failed to get brightness",
+                [=](const uchar &brightness) {
+                    // Only show the current state, don't apply it again
+                    QSignalBlocker blocker(brightnessSlider);
+                    brightnessSlider->setValue(brightness);
+                    brightnessSliderValue->setText(QString("%1%").arg(brightness * 100 / 255));
+                    brightnessSlider->setEnabled(true);
+                });
 
         connect(brightnessSlider, &QSlider::valueChanged, this, [=](int value) {
             brightnessSliderValue->setText(QString("%1%").arg(value * 100 / 255));
 
-            try {
-                mLed->setBrightness(value);
-            } catch (const libopenrazer::DBusException &e) {
-                qWarning("Failed to change brightness");
-                util::showError(tr("Failed to change brightness"));
-            }
+            model->commandQueue()->submit(
+                    "brightness/" + QString::number(static_cast<int>(ledId)),
+                    [=]() { model->setBrightness(ledId, value); }, this,
+                    [=]() {
+                        qWarning("Failed to change brightness");
+                        util::showError(tr("Failed to change brightness"));
+                    });
         });
 
         verticalLayout->addWidget(brightnessLabel);
@@ -205,6 +234,19 @@ void LedWidget::fxComboboxChanged(int index)
     if (!isCustomEffect)
         sender->removeItem(sender->findText("Custom Effect"));
 
+    updateControls(capability);
+
+    /* Actually go apply the effect in all cases, except for Custom Effect
+     * because there we handle this in the CustomEditor class */
+    if (!isCustomEffect)
+        applyEffectStandardLoc(capability.getIdentifier());
+}
+
+/*
+ * Show only the color buttons and direction radio buttons the effect uses.
+ */
+void LedWidget::updateControls(const libopenrazer::Capability &capability)
+{
     // Show/hide the color buttons
     if (capability.getNumColors() == 0) { // hide all
         for (int i = 1; i <= 3; i++)
@@ -226,11 +268,6 @@ void LedWidget::fxComboboxChanged(int index)
         findChild<QRadioButton *>("radiobutton1")->show();
         findChild<QRadioButton *>("radiobutton2")->show();
     }
-
-    /* Actually go apply the effect in all cases, except for Custom Effect
-     * because there we handle this in the CustomEditor class */
-    if (!isCustomEffect)
-        applyEffectStandardLoc(capability.getIdentifier());
 }
 
 openrazer::RGB LedWidget::getColorForButton(int num)
@@ -252,76 +289,88 @@ openrazer::WheelDirection LedWidget::getWheelDirection()
             : openrazer::WheelDirection::COUNTER_CLOCKWISE;
 }
 
+/*
+ * The effect is applied through the model, which can apply it again after
+ * the daemon has been restarted. So the lambdas must only capture values,
+ * not read from the widgets.
+ */
 void LedWidget::applyEffectStandardLoc(openrazer::Effect effect)
 {
+    std::function<void(libopenrazer::Led *)> apply;
+
+    switch (effect) {
+    case openrazer::Effect::Off: {
+        apply = [](libopenrazer::Led *led) { led->setOff(); };
+        break;
+    }
+    case openrazer::Effect::On: {
+        apply = [](libopenrazer::Led *led) { led->setOn(); };
+        break;
+    }
+    case openrazer::Effect::Static: {
+        openrazer::RGB c = getColorForButton(1);
+        apply = [=](libopenrazer::Led *led) { led->setStatic(c); };
+        break;
+    }
+    case openrazer::Effect::Breathing: {
+        openrazer::RGB c = getColorForButton(1);
+        apply = [=](libopenrazer::Led *led) { led->setBreathing(c); };
+        break;
+    }
+    case openrazer::Effect::BreathingDual: {
+        openrazer::RGB c1 = getColorForButton(1);
+        openrazer::RGB c2 = getColorForButton(2);
+        apply = [=](libopenrazer::Led *led) { led->setBreathingDual(c1, c2); };
+        break;
+    }
+    case openrazer::Effect::BreathingRandom: {
+        apply = [](libopenrazer::Led *led) { led->setBreathingRandom(); };
+        break;
+    }
+    case openrazer::Effect::BreathingMono: {
+        apply = [](libopenrazer::Led *led) { led->setBreathingMono(); };
+        break;
+    }
+    case openrazer::Effect::Blinking: {
+        openrazer::RGB c = getColorForButton(1);
+        apply = [=](libopenrazer::Led *led) { led->setBlinking(c); };
+        break;
+    }
+    case openrazer::Effect::Spectrum: {
+        apply = [](libopenrazer::Led *led) { led->setSpectrum(); };
+        break;
+    }
+    case openrazer::Effect::Wave: {
+        openrazer::WaveDirection direction = getWaveDirection();
+        apply = [=](libopenrazer::Led *led) { led->setWave(direction); };
+        break;
+    }
+    case openrazer::Effect::Wheel: {
+        openrazer::WheelDirection direction = getWheelDirection();
+        apply = [=](libopenrazer::Led *led) { led->setWheel(direction); };
+        break;
+    }
+    case openrazer::Effect::Reactive: {
+        openrazer::RGB c = getColorForButton(1);
+        apply = [=](libopenrazer::Led *led) { led->setReactive(c, openrazer::ReactiveSpeed::_500MS); }; // TODO Configure speed?
+        break;
+    }
+    case openrazer::Effect::Ripple: {
+        openrazer::RGB c = getColorForButton(1);
+        apply = [=](libopenrazer::Led *led) { led->setRipple(c); };
+        break;
+    }
+    case openrazer::Effect::RippleRandom: {
+        apply = [](libopenrazer::Led *led) { led->setRippleRandom(); };
+        break;
+    }
+    default:
+        throw new std::invalid_argument("Effect not handled: " + QVariant::fromValue(effect).toString().toStdString());
+    }
+
     try {
-        switch (effect) {
-        case openrazer::Effect::Off: {
-            mLed->setOff();
-            break;
-        }
-        case openrazer::Effect::On: {
-            mLed->setOn();
-            break;
-        }
-        case openrazer::Effect::Static: {
-            openrazer::RGB c = getColorForButton(1);
-            mLed->setStatic(c);
-            break;
-        }
-        case openrazer::Effect::Breathing: {
-            openrazer::RGB c = getColorForButton(1);
-            mLed->setBreathing(c);
-            break;
-        }
-        case openrazer::Effect::BreathingDual: {
-            openrazer::RGB c1 = getColorForButton(1);
-            openrazer::RGB c2 = getColorForButton(2);
-            mLed->setBreathingDual(c1, c2);
-            break;
-        }
-        case openrazer::Effect::BreathingRandom: {
-            mLed->setBreathingRandom();
-            break;
-        }
-        case openrazer::Effect::BreathingMono: {
-            mLed->setBreathingMono();
-            break;
-        }
-        case openrazer::Effect::Blinking: {
-            openrazer::RGB c = getColorForButton(1);
-            mLed->setBlinking(c);
-            break;
-        }
-        case openrazer::Effect::Spectrum: {
-            mLed->setSpectrum();
-            break;
-        }
-        case openrazer::Effect::Wave: {
-            mLed->setWave(getWaveDirection());
-            break;
-        }
-        case openrazer::Effect::Wheel: {
-            mLed->setWheel(getWheelDirection());
-            break;
-        }
-        case openrazer::Effect::Reactive: {
-            openrazer::RGB c = getColorForButton(1);
-            mLed->setReactive(c, openrazer::ReactiveSpeed::_500MS); // TODO Configure speed?
-            break;
-        }
-        case openrazer::Effect::Ripple: {
-            openrazer::RGB c = getColorForButton(1);
-            mLed->setRipple(c);
-            break;
-        }
-        case openrazer::Effect::RippleRandom: {
-            mLed->setRippleRandom();
-            break;
-        }
-        default:
-            throw new std::invalid_argument("Effect not handled: " + QVariant::fromValue(effect).toString().toStdString());
-        }
+        model->applyEffect(ledId, apply);
+        emit effectApplied();
     } catch (const libopenrazer::DBusException &e) {
         qWarning("Failed to change effect");
         util::showError(tr("Failed to change effect"));
@@ -339,5 +388,5 @@ void LedWidget::applyEffect()
 
 libopenrazer::Led *LedWidget::led()
 {
-    return mLed;
+    return model->led(ledId);
 }
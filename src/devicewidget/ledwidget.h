@@ -5,21 +5,22 @@
 #ifndef LEDWIDGET_H
 #define LEDWIDGET_H
 
+#include "devicemodel.h"
+
 #include <QWidget>
-#include <libopenrazer.h>
 
 class LedWidget : public QWidget
 {
     Q_OBJECT
 public:
-    LedWidget(QWidget *parent, libopenrazer::Led *led);
-    libopenrazer::Led *mLed;
+    LedWidget(QWidget *parent, DeviceModel *model, openrazer::LedId ledId);
     libopenrazer::Led *led();
 
     // Color buttons
     void colorButtonClicked();
     // Effect comboboxes
     void fxComboboxChanged(int index);
+    void updateControls(const libopenrazer::Capability &capability);
 
     openrazer::RGB getColorForButton(int num);
     openrazer::WaveDirection getWaveDirection();
@@ -27,6 +28,14 @@ public:
 
     void applyEffect();
     void applyEffectStandardLoc(openrazer::Effect identifier);
+
+signals:
+    /* A hardware effect has been applied, replacing any custom frame */
+    void effectApplied();
+
+private:
+    DeviceModel *model;
+    openrazer::LedId ledId;
 };
 
 #endif // LEDWIDGET_H
@@ -5,18 +5,20 @@
 #include "lightingwidget.h"
 
 #include "clickeventfilter.h"
-#include "customeditor/customeditor.h"
 #include "ledwidget.h"
+#include "util.h"
 
 #include <QComboBox>
+#include <QHBoxLayout>
 #include <QLabel>
 #include <QPushButton>
+#include <QSlider>
 #include <QVBoxLayout>
 
-LightingWidget::LightingWidget(libopenrazer::Device *device)
+LightingWidget::LightingWidget(DeviceModel *model)
     : QWidget()
 {
-    this->device = device;
+    this->model = model;
 
     auto *verticalLayout = new QVBoxLayout(this);
 
@@ -26,13 +28,30 @@ LightingWidget::LightingWidget(libopenrazer::Device *device)
     lightingHeader->setFont(headerFont);
     verticalLayout->addWidget(lightingHeader);
 
+    /* Custom lighting, the compositor owns the custom frame of the device */
+    if (model->hasFeature("custom_frame")) {
+        compositor = new LayerCompositor(model, this);
+        connect(compositor, &LayerCompositor::activated, this, &LightingWidget::selectCustomEffect);
+        connect(compositor, &LayerCompositor::errorOccurred, this, [=]() {
+            util::showError(tr("Error updating the lighting data."));
+        });
+    }
+
     /* Create LedWidget for all LEDs */
-    for (libopenrazer::Led *led : device->getLeds()) {
-        verticalLayout->addWidget(new LedWidget(this, led));
+    for (libopenrazer::Led *led : model->leds()) {
+        auto *ledWidget = new LedWidget(this, model, led->getLedId());
+        verticalLayout->addWidget(ledWidget);
+
+        /* Hardware effects replace the custom frame, so stop sending it */
+        if (compositor != nullptr) {
+            connect(ledWidget, &LedWidget::effectApplied, this, [=]() {
+                compositor->setActive(false);
+            });
+        }
     }
 
     /* Custom lighting */
-    if (device->hasFeature("custom_frame")) {
+    if (compositor != nullptr) {
         auto *button = new QPushButton(this);
         button->setText(tr("Open custom editor"));
 
@@ -46,6 +65,9 @@ LightingWidget::LightingWidget(libopenrazer::Device *device)
                 [=]() { openCustomEditor(true); });
         connect(button, &QPushButton::clicked,
                 [=]() { openCustomEditor(false); });
+
+        verticalLayout->addLayout(buildAnimationControls());
+        verticalLayout->addLayout(buildPaintLayerControls());
     }
 
     /* Spacer to bottom */
@@ -53,14 +75,110 @@ LightingWidget::LightingWidget(libopenrazer::Device *device)
     verticalLayout->addItem(spacer);
 }
 
-LightingWidget::~LightingWidget() = default;
+LightingWidget::~LightingWidget()
+{
+    // Stopping the animation clears its layer, so the compositor has to outlive it
+    delete animationEngine;
+    // The editor is a separate window which would keep using the compositor
+    delete customEditor;
+}
 
-bool LightingWidget::isAvailable(libopenrazer::Device *device)
+bool LightingWidget::isAvailable(DeviceModel *model)
 {
-    return !device->getLeds().isEmpty() || device->hasFeature("custom_frame");
+    return !model->leds().isEmpty() || model->hasFeature("custom_frame");
 }
 
-void LightingWidget::openCustomEditor(bool forceFallback)
+bool LightingWidget::isInUse() const
+{
+    return !customEditor.isNull() || (compositor != nullptr && compositor->isActive());
+}
+
+/*
+ * Controls for the software animations which get rendered on the PC and
+ * sent to the device as custom frames.
+ */
+QLayout *LightingWidget::buildAnimationControls()
+{
+    animationEngine = new AnimationEngine(compositor, this);
+
+    auto *hbox = new QHBoxLayout();
+
+    auto *effectComboBox = new QComboBox(this);
+    effectComboBox->addItem(tr("No software effect"));
+    effectComboBox->addItem(tr("Spectrum wave"));
+
+    auto *fpsComboBox = new QComboBox(this);
+    fpsComboBox->addItem(tr("30 FPS"), 30);
+    fpsComboBox->addItem(tr("60 FPS"), 60);
+
+    auto *statsLabel = new QLabel(this);
+
+    hbox->addWidget(effectComboBox);
+    hbox->addWidget(fpsComboBox);
+    hbox->addWidget(statsLabel);
+
+    auto restartAnimation = [=]() {
+        animationEngine->stop();
+        statsLabel->clear();
+        if (effectComboBox->currentIndex() == 1) {
+            animationEngine->start(AnimationEngine::spectrumWave(), fpsComboBox->currentData().toInt());
+        }
+    };
+
+    connect(effectComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, restartAnimation);
+    connect(fpsComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, restartAnimation);
+
+    connect(animationEngine, &AnimationEngine::statsUpdated, this, [=](AnimationStats stats) {
+        statsLabel->setText(tr("%1 FPS, %2 dropped, render %3 ms, upload %4 ms")
+                                    .arg(stats.fps, 0, 'f', 1)
+                                    .arg(stats.droppedFrames)
+                                    .arg(stats.renderNsecs / 1000000.0, 0, 'f', 2)
+                                    .arg(stats.uploadNsecs / 1000000.0, 0, 'f', 2));
+    });
+    /* A hardware effect has been selected, which replaces the animation */
+    connect(compositor, &LayerCompositor::deactivated, this, [=]() {
+        effectComboBox->setCurrentIndex(0);
+    });
+    // The compositor reports the error itself
+    connect(animationEngine, &AnimationEngine::errorOccurred, this, [=]() {
+        effectComboBox->setCurrentIndex(0);
+    });
+
+    return hbox;
+}
+
+/*
+ * How the keys painted in the custom editor show on top of the software
+ * effect.
+ */
+QLayout *LightingWidget::buildPaintLayerControls()
+{
+    auto *hbox = new QHBoxLayout();
+
+    auto *blendModeComboBox = new QComboBox(this);
+    blendModeComboBox->addItem(tr("Painted keys cover the effect"), QVariant::fromValue(BlendMode::Normal));
+    blendModeComboBox->addItem(tr("Painted keys brighten the effect"), QVariant::fromValue(BlendMode::Add));
+    blendModeComboBox->addItem(tr("Painted keys tint the effect"), QVariant::fromValue(BlendMode::Multiply));
+
+    auto *opacitySlider = new QSlider(Qt::Horizontal, this);
+    opacitySlider->setMaximum(255);
+    opacitySlider->setValue(255);
+    opacitySlider->setToolTip(tr("Opacity of the painted keys"));
+
+    hbox->addWidget(blendModeComboBox);
+    hbox->addWidget(opacitySlider);
+
+    connect(blendModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=]() {
+        compositor->setBlendMode(LayerCompositor::PaintLayer, blendModeComboBox->currentData().value<BlendMode>());
+    });
+    connect(opacitySlider, &QSlider::valueChanged, this, [=](int opacity) {
+        compositor->setOpacity(LayerCompositor::PaintLayer, opacity);
+    });
+
+    return hbox;
+}
+
+void LightingWidget::selectCustomEffect()
 {
     /* Set combobox(es) to "Custom Effect" */
     auto comboboxes = this->findChildren<QComboBox *>("combobox");
@@ -69,8 +187,13 @@ void LightingWidget::openCustomEditor(bool forceFallback)
             combobox->addItem("Custom Effect");
         combobox->setCurrentText("Custom Effect");
     }
+}
+
+void LightingWidget::openCustomEditor(bool forceFallback)
+{
+    selectCustomEffect();
 
-    auto *cust = new CustomEditor(device, forceFallback);
-    cust->setAttribute(Qt::WA_DeleteOnClose);
-    cust->show();
+    customEditor = new CustomEditor(model, compositor, forceFallback);
+    customEditor->setAttribute(Qt::WA_DeleteOnClose);
+    customEditor->show();
 }
@@ -5,21 +5,35 @@
 #ifndef LIGHTINGWIDGET_H
 #define LIGHTINGWIDGET_H
 
+#include "customeditor/customeditor.h"
+#include "devicemodel.h"
+#include "lighting/animationengine.h"
+#include "lighting/layercompositor.h"
+
+#include <QPointer>
 #include <QWidget>
-#include <libopenrazer.h>
 
 class LightingWidget : public QWidget
 {
     Q_OBJECT
 public:
-    LightingWidget(libopenrazer::Device *device);
+    LightingWidget(DeviceModel *model);
     ~LightingWidget() override;
 
-    static bool isAvailable(libopenrazer::Device *device);
+    static bool isAvailable(DeviceModel *model);
+
+    /* The custom editor is open or custom frames are being sent */
+    bool isInUse() const;
 
 private:
-    libopenrazer::Device *device;
+    DeviceModel *model;
+    LayerCompositor *compositor = nullptr;
+    AnimationEngine *animationEngine = nullptr;
+    QPointer<CustomEditor> customEditor;
 
+    QLayout *buildAnimationControls();
+    QLayout *buildPaintLayerControls();
+    void selectCustomEffect();
     void openCustomEditor(bool forceFallback);
 };
 
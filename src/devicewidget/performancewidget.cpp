@@ -12,40 +12,40 @@
 #include <QLabel>
 #include <QVBoxLayout>
 
-PerformanceWidget::PerformanceWidget(libopenrazer::Device *device)
+PerformanceWidget::PerformanceWidget(DeviceModel *model)
     : QWidget()
 {
-    this->device = device;
+    this->model = model;
 
     auto *verticalLayout = new QVBoxLayout(this);
 
     QFont headerFont("Arial", 15, QFont::Bold);
 
     /* DPI sliders */
-    if (device->hasFeature("dpi")) {
-        if (device->hasFeature("restricted_dpi")) {
-            verticalLayout->addWidget(new DpiComboBoxWidget(this, device));
+    if (model->hasFeature("dpi")) {
+        if (model->hasFeature("restricted_dpi")) {
+            verticalLayout->addWidget(new DpiComboBoxWidget(this, model));
         } else {
-            verticalLayout->addWidget(new DpiSliderWidget(this, device));
+            verticalLayout->addWidget(new DpiSliderWidget(this, model));
         }
     }
 
     /* Poll rate */
-    if (device->hasFeature("poll_rate")) {
+    if (model->hasFeature("poll_rate")) {
         QLabel *pollRateHeader = new QLabel(tr("Polling rate"), this);
         pollRateHeader->setFont(headerFont);
         verticalLayout->addWidget(pollRateHeader);
 
         ushort pollRate = 0;
         try {
-            pollRate = device->getPollRate();
+            pollRate = model->pollRate();
         } catch (const libopenrazer::DBusException &e) {
             qWarning("Failed to get poll rate");
         }
 
         QVector<ushort> supportedPollRates;
         try {
-            supportedPollRates = device->getSupportedPollRates();
+            supportedPollRates = model->supportedPollRates();
         } catch (const libopenrazer::DBusException &e) {
             qWarning("Failed to get supported poll rates");
         }
@@ -58,12 +58,13 @@ PerformanceWidget::PerformanceWidget(libopenrazer::Device *device)
         verticalLayout->addWidget(pollComboBox);
 
         connect(pollComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=](int) {
-            try {
-                device->setPollRate(pollComboBox->currentData().value<ushort>());
-            } catch (const libopenrazer::DBusException &e) {
-                qWarning("Failed to set polling rate");
-                util::showError(tr("Failed to set polling rate"));
-            }
+            ushort pollRate = pollComboBox->currentData().value<ushort>();
+            model->commandQueue()->submit(
+                    "pollRate", [=]() { model->setPollRate(pollRate); }, this,
+                    [=]() {
+                        qWarning("Failed to set polling rate");
+                        util::showError(tr("Failed to set polling rate"));
+                    });
         });
     }
 
@@ -74,7 +75,7 @@ PerformanceWidget::PerformanceWidget(libopenrazer::Device *device)
 
 PerformanceWidget::~PerformanceWidget() = default;
 
-bool PerformanceWidget::isAvailable(libopenrazer::Device *device)
+bool PerformanceWidget::isAvailable(DeviceModel *model)
 {
-    return device->hasFeature("dpi") || device->hasFeature("poll_rate");
+    return model->hasFeature("dpi") || model->hasFeature("poll_rate");
 }
@@ -5,20 +5,21 @@
 #ifndef PERFORMANCEWIDGET_H
 #define PERFORMANCEWIDGET_H
 
+#include "devicemodel.h"
+
 #include <QWidget>
-#include <libopenrazer.h>
 
 class PerformanceWidget : public QWidget
 {
     Q_OBJECT
 public:
-    PerformanceWidget(libopenrazer::Device *device);
+    PerformanceWidget(DeviceModel *model);
     ~PerformanceWidget() override;
 
-    static bool isAvailable(libopenrazer::Device *device);
+    static bool isAvailable(DeviceModel *model);
 
 private:
-    libopenrazer::Device *device;
+    DeviceModel *model;
 };
 
 #endif // PERFORMANCEWIDGET_H
@@ -4,6 +4,7 @@
 
 #include "powerwidget.h"
 
+#include "asyncread.h"
 #include "util.h"
 
 #include <QLabel>
@@ -11,35 +12,33 @@
 #include <QSlider>
 #include <QVBoxLayout>
 
-PowerWidget::PowerWidget(libopenrazer::Device *device)
+PowerWidget::PowerWidget(DeviceModel *model)
     : QWidget()
 {
-    this->device = device;
+    this->model = model;
 
     auto *verticalLayout = new QVBoxLayout(this);
 
     QFont headerFont("Arial", 15, QFont::Bold);
 
     /* Battery */
-    if (device->hasFeature("battery")) {
+    if (model->hasFeature("battery")) {
         auto *batteryHeaderHBox = new QHBoxLayout();
 
         QLabel *batterHeader = new QLabel(tr("Battery"), this);
         batterHeader->setFont(headerFont);
 
-        bool charging = false;
-        try {
-            charging = device->isCharging();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get charging status");
-        }
-
         QLabel *chargingLabel = new QLabel(this);
-        if (charging) {
-            chargingLabel->setText(tr("Charging"));
-        } else {
-            chargingLabel->setText(tr("Not Charging"));
-        }
+        chargingLabel->setText("…");
+        util::readAsync<bool>(
+                model->readPool(), this, [=]() { return model->isCharging(); }, false, "Failed to get charging status",
+                [=](const bool &charging) {
+                    if (charging) {
+                        chargingLabel->setText(tr("Charging"));
+                    } else {
+                        chargingLabel->setText(tr("Not Charging"));
+                    }
+                });
 
         batteryHeaderHBox->addWidget(batterHeader);
         batteryHeaderHBox->addItem(new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum));
@@ -47,32 +46,25 @@ PowerWidget::PowerWidget(libopenrazer::Device *device)
 
         verticalLayout->addLayout(batteryHeaderHBox);
 
-        double percent = 0.0;
-        try {
-            percent = device->getBatteryPercent();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get battery charge percentage");
-        }
-
+        // Busy indicator until the charge has been read
         auto *progressBar = new QProgressBar;
-        progressBar->setValue(percent);
+        progressBar->setRange(0, 0);
+        util::readAsync<double>(
+                model->readPool(), this, [=]() { return model->batteryPercent(); }, 0.0, "Failed to get battery charge percentage",
+                [=](const double &percent) {
+                    progressBar->setRange(0, 100);
+                    progressBar->setValue(percent);
+                });
 
         verticalLayout->addWidget(progressBar);
     }
 
     /* Idle time / Sleep mode after */
-    if (device->hasFeature("idle_time")) {
+    if (model->hasFeature("idle_time")) {
         QLabel *idleTimeHeader = new QLabel(tr("Sleep mode after"), this);
         idleTimeHeader->setFont(headerFont);
         verticalLayout->addWidget(idleTimeHeader);
 
-        ushort idleTimeSec = 0;
-        try {
-            idleTimeSec = device->getIdleTime();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get idle time");
-        }
-
         auto *idleTimeHBox = new QHBoxLayout();
 
         auto *idleTimeSlider = new QSlider(Qt::Horizontal, this);
@@ -81,20 +73,30 @@ PowerWidget::PowerWidget(libopenrazer::Device *device)
         idleTimeSlider->setMinimum(1);
         idleTimeSlider->setMaximum(15);
         idleTimeSlider->setPageStep(1);
-        idleTimeSlider->setValue(idleTimeSec / 60);
+        idleTimeSlider->setEnabled(false);
 
         auto *idleTimeLabel = new QLabel(this);
-        idleTimeLabel->setText(tr("%1 minutes").arg(idleTimeSec / 60));
+        idleTimeLabel->setText("…");
+
+        util::readAsync<ushort>(
+                model->readPool(), this, [=]() { return model->idleTime(); }, 0, "Failed to get idle time",
+                [=](const ushort &idleTimeSec) {
+                    // Only show the current state, don't apply it again
+                    QSignalBlocker blocker(idleTimeSlider);
+                    idleTimeSlider->setValue(idleTimeSec / 60);
+                    idleTimeLabel->setText(tr("%1 minutes").arg(idleTimeSec / 60));
+                    idleTimeSlider->setEnabled(true);
+                });
 
         connect(idleTimeSlider, &QSlider::valueChanged, this, [=](int idleTimeMin) {
             idleTimeLabel->setText(tr("%1 minutes").arg(idleTimeMin));
 
-            try {
-                device->setIdleTime(idleTimeMin * 60);
-            } catch (const libopenrazer::DBusException &e) {
-                qWarning("Failed to set idle time");
-                util::showError(tr("Failed to set idle time"));
-            }
+            model->commandQueue()->submit(
+                    "idleTime", [=]() { model->setIdleTime(idleTimeMin * 60); }, this,
+                    [=]() {
+                        qWarning("Failed to set idle time");
+                        util::showError(tr("Failed to set idle time"));
+                    });
         });
 
         idleTimeHBox->addWidget(idleTimeSlider);
@@ -103,37 +105,40 @@ PowerWidget::PowerWidget(libopenrazer::Device *device)
     }
 
     /* Low battery threshold / Enter low power at */
-    if (device->hasFeature("low_battery_threshold")) {
+    if (model->hasFeature("low_battery_threshold")) {
         QLabel *lowBatteryThresholdHeader = new QLabel(tr("Enter lower power at"), this);
         lowBatteryThresholdHeader->setFont(headerFont);
         verticalLayout->addWidget(lowBatteryThresholdHeader);
 
-        ushort threshold = 0;
-        try {
-            threshold = device->getLowBatteryThreshold();
-        } catch (const libopenrazer::DBusException &e) {
-            qWarning("Failed to get low battery threshold");
-        }
-
         auto *lowBatteryThresholdHBox = new QHBoxLayout();
 
         auto *lowBatteryThresholdSlider = new QSlider(Qt::Horizontal, this);
         lowBatteryThresholdSlider->setMinimum(1);
         lowBatteryThresholdSlider->setMaximum(100);
-        lowBatteryThresholdSlider->setValue(threshold);
+        lowBatteryThresholdSlider->setEnabled(false);
 
         auto *lowBatteryThresholdLabel = new QLabel(this);
-        lowBatteryThresholdLabel->setText(QString("%1%").arg(threshold));
+        lowBatteryThresholdLabel->setText("…");
+
+        util::readAsync<ushort>(
+                model->readPool(), this, [=]() { return model->lowBatteryThreshold(); }, 0, "Failed to get low battery threshold",
+                [=](const ushort &threshold) {
+                    // Only show the current state, don't apply it again
+                    QSignalBlocker blocker(lowBatteryThresholdSlider);
+                    lowBatteryThresholdSlider->setValue(threshold);
+                    lowBatteryThresholdLabel->setText(QString("%1%").arg(threshold));
+                    lowBatteryThresholdSlider->setEnabled(true);
+                });
 
         connect(lowBatteryThresholdSlider, &QSlider::valueChanged, this, [=](int threshold) {
             lowBatteryThresholdLabel->setText(QString("%1%").arg(threshold));
 
-            try {
-                device->setLowBatteryThreshold(threshold);
-            } catch (const libopenrazer::DBusException &e) {
-                qWarning("Failed to set low battery threshold");
-                util::showError(tr("Failed to set low battery threshold"));
-            }
+            model->commandQueue()->submit(
+                    "lowBatteryThreshold", [=]() { model->setLowBatteryThreshold(threshold); }, this,
+                    [=]() {
+                        qWarning("Failed to set low battery threshold");
+                        util::showError(tr("Failed to set low battery threshold"));
+                    });
         });
 
         lowBatteryThresholdHBox->addWidget(lowBatteryThresholdSlider);
@@ -148,7 +153,7 @@ PowerWidget::PowerWidget(libopenrazer::Device *device)
 
 PowerWidget::~PowerWidget() = default;
 
-bool PowerWidget::isAvailable(libopenrazer::Device *device)
+bool PowerWidget::isAvailable(DeviceModel *model)
 {
-    return device->hasFeature("battery") || device->hasFeature("idle_time") || device->hasFeature("low_battery_threshold");
+    return model->hasFeature("battery") || model->hasFeature("idle_time") || model->hasFeature("low_battery_threshold");
 }
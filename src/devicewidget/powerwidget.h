@@ -5,20 +5,21 @@
 #ifndef POWERWIDGET_H
 #define POWERWIDGET_H
 
+#include "devicemodel.h"
+
 #include <QWidget>
-#include <libopenrazer.h>
 
 class PowerWidget : public QWidget
 {
     Q_OBJECT
 public:
-    PowerWidget(libopenrazer::Device *device);
+    PowerWidget(DeviceModel *model);
     ~PowerWidget() override;
 
-    static bool isAvailable(libopenrazer::Device *device);
+    static bool isAvailable(DeviceModel *model);
 
 private:
-    libopenrazer::Device *device;
+    DeviceModel *model;
 };
 
 #endif // POWERWIDGET_H
@@ -0,0 +1,176 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "animationengine.h"
+
+#include "util.h"
+
+#include <QColor>
+
+/* Interval in which the statistics get reported */
+#define STATS_INTERVAL_MS (1000)
+
+AnimationWorker::AnimationWorker(LayerCompositor *compositor)
+    : compositor(compositor)
+{
+    frames.resize(compositor->dimensions());
+}
+
+AnimationWorker::~AnimationWorker() = default;
+
+void AnimationWorker::start(AnimationRenderer renderer, int fps)
+{
+    // Timers need to be created on the thread they're used on
+    if (frameTimer == nullptr) {
+        frameTimer = new QTimer(this);
+        frameTimer->setTimerType(Qt::PreciseTimer);
+        connect(frameTimer, &QTimer::timeout, this, &AnimationWorker::tick);
+
+        statsTimer = new QTimer(this);
+        statsTimer->setInterval(STATS_INTERVAL_MS);
+        connect(statsTimer, &QTimer::timeout, this, &AnimationWorker::reportStats);
+    }
+
+    this->renderer = renderer;
+    this->fps = qMax(1, fps);
+    lastFrameIndex = -1;
+    frames.front().clear();
+    stats = AnimationStats();
+    intervalFrames = 0;
+    intervalRenderNsecs = 0;
+    intervalUploadNsecs = 0;
+
+    clock.start();
+    intervalClock.start();
+    // The timer only has millisecond precision, the frame index below doesn't
+    // depend on it
+    frameTimer->start(1000 / this->fps);
+    statsTimer->start();
+}
+
+void AnimationWorker::stop()
+{
+    if (frameTimer == nullptr)
+        return;
+
+    frameTimer->stop();
+    statsTimer->stop();
+}
+
+void AnimationWorker::tick()
+{
+    /* Timer events don't queue up when a frame takes too long, so count how
+     * many frame slots we missed since the last frame */
+    qint64 frameIndex = clock.elapsed() * fps / 1000;
+    // The timer fires slightly faster than the frame rate, the frame for this
+    // slot has been shown already
+    if (frameIndex == lastFrameIndex)
+        return;
+    if (lastFrameIndex >= 0 && frameIndex - lastFrameIndex > 1)
+        stats.droppedFrames += frameIndex - lastFrameIndex - 1;
+    lastFrameIndex = frameIndex;
+
+    QElapsedTimer timer;
+    timer.start();
+    renderer(frames.back(), frames.front(), frameIndex * 1000 / fps);
+    qint64 renderNsecs = timer.nsecsElapsed();
+
+    timer.restart();
+    compositor->setLayerFrame(LayerCompositor::BaseLayer, frames.back());
+    compositor->tick();
+    qint64 uploadNsecs = timer.nsecsElapsed();
+    frames.swap();
+
+    intervalFrames++;
+    intervalRenderNsecs += renderNsecs;
+    intervalUploadNsecs += uploadNsecs;
+}
+
+void AnimationWorker::reportStats()
+{
+    qint64 elapsed = intervalClock.restart();
+    if (elapsed <= 0)
+        return;
+
+    stats.fps = intervalFrames * 1000.0 / elapsed;
+    stats.renderNsecs = intervalFrames > 0 ? intervalRenderNsecs / intervalFrames : 0;
+    stats.uploadNsecs = intervalFrames > 0 ? intervalUploadNsecs / intervalFrames : 0;
+
+    intervalFrames = 0;
+    intervalRenderNsecs = 0;
+    intervalUploadNsecs = 0;
+
+    emit statsUpdated(stats);
+}
+
+AnimationEngine::AnimationEngine(LayerCompositor *compositor, QObject *parent)
+    : QObject(parent), compositor(compositor)
+{
+    qRegisterMetaType<AnimationStats>();
+
+    worker = new AnimationWorker(compositor);
+    worker->moveToThread(&thread);
+
+    connect(worker, &AnimationWorker::statsUpdated, this, &AnimationEngine::statsUpdated);
+    // Frames are uploaded by the compositor, stop sending them on errors
+    connect(compositor, &LayerCompositor::errorOccurred, this, [=]() {
+        if (!running)
+            return;
+        qWarning("Failed to upload animation frame, stopping animation");
+        stop();
+        emit errorOccurred();
+    });
+
+    thread.setObjectName("AnimationEngine");
+    thread.start();
+}
+
+AnimationEngine::~AnimationEngine()
+{
+    stop();
+    thread.quit();
+    thread.wait();
+    delete worker;
+}
+
+void AnimationEngine::start(AnimationRenderer renderer, int fps)
+{
+    compositor->setActive(true);
+    QMetaObject::invokeMethod(worker, [=]() { worker->start(renderer, fps); });
+    running = true;
+}
+
+void AnimationEngine::stop()
+{
+    if (!running)
+        return;
+
+    // Wait until the worker is stopped, so no frame gets sent afterwards
+    QMetaObject::invokeMethod(worker, &AnimationWorker::stop, Qt::BlockingQueuedConnection);
+    running = false;
+
+    // Leave the other layers (e.g. painted keys) visible
+    compositor->clearLayer(LayerCompositor::BaseLayer);
+}
+
+bool AnimationEngine::isRunning() const
+{
+    return running;
+}
+
+AnimationRenderer AnimationEngine::spectrumWave()
+{
+    return [](Framebuffer &frame, const Framebuffer & /* previous */, qint64 elapsedMs) {
+        int columns = frame.columns();
+        for (int col = 0; col < columns; col++) {
+            // One full cycle over the width of the matrix, moving with 90 degrees per second
+            int hue = (col * 360 / columns + elapsedMs * 90 / 1000) % 360;
+            QColor color = QColor::fromHsv(hue, 255, 255);
+            openrazer::RGB rgb = QCOLOR_TO_RGB(color);
+            for (int row = 0; row < frame.rows(); row++) {
+                frame.at(row, col) = rgb;
+            }
+        }
+    };
+}
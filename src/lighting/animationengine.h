@@ -0,0 +1,105 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ANIMATIONENGINE_H
+#define ANIMATIONENGINE_H
+
+#include "framebuffer.h"
+#include "layercompositor.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <functional>
+#include <libopenrazer.h>
+
+struct AnimationStats {
+    /* Frames per second achieved during the last measuring interval */
+    double fps = 0;
+    /* Total number of frames which could not be rendered in time */
+    quint64 droppedFrames = 0;
+    /* Average time spent rendering / compositing and queueing a frame for
+     * upload during the last interval */
+    qint64 renderNsecs = 0;
+    qint64 uploadNsecs = 0;
+};
+Q_DECLARE_METATYPE(AnimationStats)
+
+/* Renders frame for the given time (in milliseconds since the animation
+ * started), previous still holds the last rendered frame */
+using AnimationRenderer = std::function<void(Framebuffer &frame, const Framebuffer &previous, qint64 elapsedMs)>;
+
+/*
+ * Runs on the thread owned by AnimationEngine, never use directly.
+ */
+class AnimationWorker : public QObject
+{
+    Q_OBJECT
+public:
+    AnimationWorker(LayerCompositor *compositor);
+    ~AnimationWorker() override;
+
+    void start(AnimationRenderer renderer, int fps);
+    void stop();
+
+signals:
+    void statsUpdated(AnimationStats stats);
+
+private:
+    void tick();
+    void reportStats();
+
+    LayerCompositor *compositor;
+
+    QTimer *frameTimer = nullptr;
+    QTimer *statsTimer = nullptr;
+    QElapsedTimer clock;
+    AnimationRenderer renderer;
+    DoubleFramebuffer frames;
+
+    int fps = 0;
+    qint64 lastFrameIndex = -1;
+
+    AnimationStats stats;
+    int intervalFrames = 0;
+    qint64 intervalRenderNsecs = 0;
+    qint64 intervalUploadNsecs = 0;
+    QElapsedTimer intervalClock;
+};
+
+/*
+ * Software animation engine for devices with the "custom_frame" feature.
+ *
+ * Frames are rendered on a dedicated thread at a fixed frame rate into the
+ * base layer of a LayerCompositor, which also gets ticked from that thread
+ * to upload the result. Statistics about the achieved frame rate are reported once per
+ * second through statsUpdated().
+ */
+class AnimationEngine : public QObject
+{
+    Q_OBJECT
+public:
+    AnimationEngine(LayerCompositor *compositor, QObject *parent = nullptr);
+    ~AnimationEngine() override;
+
+    void start(AnimationRenderer renderer, int fps);
+    void stop();
+    bool isRunning() const;
+
+    /* Built-in renderers */
+    static AnimationRenderer spectrumWave();
+
+signals:
+    void statsUpdated(AnimationStats stats);
+    void errorOccurred();
+
+private:
+    QThread thread;
+    LayerCompositor *compositor;
+    AnimationWorker *worker;
+    bool running = false;
+};
+
+#endif // ANIMATIONENGINE_H
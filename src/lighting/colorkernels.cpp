@@ -0,0 +1,405 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "colorkernels.h"
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define COLORKERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Kernels {
+    colorkernels::Implementation implementation;
+    void (*blendAlpha)(uchar *dst, const uchar *src, int bytes, uchar alpha);
+    void (*blendMasked)(uchar *dst, const uchar *src, const uchar *mask, int bytes);
+    void (*blendAdd)(uchar *dst, const uchar *src, int bytes);
+    void (*blendMultiply)(uchar *dst, const uchar *src, int bytes);
+    void (*scale)(uchar *dst, int bytes, uchar factor);
+    void (*fadeToBlack)(uchar *dst, int bytes, uchar amount);
+};
+
+/* Rounded x / 255, exact for 0 <= x <= 255 * 255 */
+inline int div255(int x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/* Scalar implementation */
+
+void blendAlphaScalar(uchar *dst, const uchar *src, int bytes, uchar alpha)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = div255(dst[i] * (255 - alpha) + src[i] * alpha);
+}
+
+void blendMaskedScalar(uchar *dst, const uchar *src, const uchar *mask, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = div255(dst[i] * (255 - mask[i]) + src[i] * mask[i]);
+}
+
+void blendAddScalar(uchar *dst, const uchar *src, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = qMin(dst[i] + src[i], 255);
+}
+
+void blendMultiplyScalar(uchar *dst, const uchar *src, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = div255(dst[i] * src[i]);
+}
+
+void scaleScalar(uchar *dst, int bytes, uchar factor)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = div255(dst[i] * factor);
+}
+
+void fadeToBlackScalar(uchar *dst, int bytes, uchar amount)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = qMax(dst[i] - amount, 0);
+}
+
+const Kernels scalarKernels = {
+    colorkernels::Implementation::Scalar,
+    blendAlphaScalar,
+    blendMaskedScalar,
+    blendAddScalar,
+    blendMultiplyScalar,
+    scaleScalar,
+    fadeToBlackScalar,
+};
+
+#ifdef COLORKERNELS_X86
+
+/* SSE2 implementation, processes 16 bytes per step. The framebuffer is
+ * padded to FRAMEBUFFER_ALIGNMENT so there is no tail to handle. */
+
+__attribute__((target("sse2"))) inline __m128i div255SSE2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/* Multiply the bytes of a and b, divided by 255 */
+__attribute__((target("sse2"))) inline __m128i mulDiv255SSE2(__m128i a, __m128i b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = div255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+    __m128i hi = div255SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+    return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("sse2"))) void blendAlphaSSE2(uchar *dst, const uchar *src, int bytes, uchar alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i a = _mm_set1_epi16(alpha);
+    const __m128i invA = _mm_set1_epi16(255 - alpha);
+    for (int i = 0; i < bytes; i += 16) {
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_load_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invA),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), a));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invA),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), a));
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i),
+                        _mm_packus_epi16(div255SSE2(lo), div255SSE2(hi)));
+    }
+}
+
+__attribute__((target("sse2"))) void blendMaskedSSE2(uchar *dst, const uchar *src, const uchar *mask, int bytes)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    for (int i = 0; i < bytes; i += 16) {
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_load_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i m = _mm_load_si128(reinterpret_cast<const __m128i *>(mask + i));
+        __m128i mLo = _mm_unpacklo_epi8(m, zero);
+        __m128i mHi = _mm_unpackhi_epi8(m, zero);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, mLo)),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), mLo));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, mHi)),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), mHi));
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i),
+                        _mm_packus_epi16(div255SSE2(lo), div255SSE2(hi)));
+    }
+}
+
+__attribute__((target("sse2"))) void blendAddSSE2(uchar *dst, const uchar *src, int bytes)
+{
+    for (int i = 0; i < bytes; i += 16) {
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_load_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i), _mm_adds_epu8(d, s));
+    }
+}
+
+__attribute__((target("sse2"))) void blendMultiplySSE2(uchar *dst, const uchar *src, int bytes)
+{
+    for (int i = 0; i < bytes; i += 16) {
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_load_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i), mulDiv255SSE2(d, s));
+    }
+}
+
+__attribute__((target("sse2"))) void scaleSSE2(uchar *dst, int bytes, uchar factor)
+{
+    const __m128i f = _mm_set1_epi8(static_cast<char>(factor));
+    for (int i = 0; i < bytes; i += 16) {
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i *>(dst + i));
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i), mulDiv255SSE2(d, f));
+    }
+}
+
+__attribute__((target("sse2"))) void fadeToBlackSSE2(uchar *dst, int bytes, uchar amount)
+{
+    const __m128i a = _mm_set1_epi8(static_cast<char>(amount));
+    for (int i = 0; i < bytes; i += 16) {
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i *>(dst + i));
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i), _mm_subs_epu8(d, a));
+    }
+}
+
+const Kernels sse2Kernels = {
+    colorkernels::Implementation::SSE2,
+    blendAlphaSSE2,
+    blendMaskedSSE2,
+    blendAddSSE2,
+    blendMultiplySSE2,
+    scaleSSE2,
+    fadeToBlackSSE2,
+};
+
+/* AVX2 implementation, processes 32 bytes per step. Unpacking and packing
+ * both work per 128 bit lane, so the byte order is preserved. */
+
+__attribute__((target("avx2"))) inline __m256i div255AVX2(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2"))) inline __m256i mulDiv255AVX2(__m256i a, __m256i b)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = div255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)));
+    __m256i hi = div255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+__attribute__((target("avx2"))) void blendAlphaAVX2(uchar *dst, const uchar *src, int bytes, uchar alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i a = _mm256_set1_epi16(alpha);
+    const __m256i invA = _mm256_set1_epi16(255 - alpha);
+    for (int i = 0; i < bytes; i += 32) {
+        __m256i d = _mm256_load_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_load_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), invA),
+                                      _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), a));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), invA),
+                                      _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), a));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i),
+                           _mm256_packus_epi16(div255AVX2(lo), div255AVX2(hi)));
+    }
+}
+
+__attribute__((target("avx2"))) void blendMaskedAVX2(uchar *dst, const uchar *src, const uchar *mask, int bytes)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(255);
+    for (int i = 0; i < bytes; i += 32) {
+        __m256i d = _mm256_load_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_load_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i m = _mm256_load_si256(reinterpret_cast<const __m256i *>(mask + i));
+        __m256i mLo = _mm256_unpacklo_epi8(m, zero);
+        __m256i mHi = _mm256_unpackhi_epi8(m, zero);
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(full, mLo)),
+                                      _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), mLo));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(full, mHi)),
+                                      _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), mHi));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i),
+                           _mm256_packus_epi16(div255AVX2(lo), div255AVX2(hi)));
+    }
+}
+
+__attribute__((target("avx2"))) void blendAddAVX2(uchar *dst, const uchar *src, int bytes)
+{
+    for (int i = 0; i < bytes; i += 32) {
+        __m256i d = _mm256_load_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_load_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_adds_epu8(d, s));
+    }
+}
+
+__attribute__((target("avx2"))) void blendMultiplyAVX2(uchar *dst, const uchar *src, int bytes)
+{
+    for (int i = 0; i < bytes; i += 32) {
+        __m256i d = _mm256_load_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_load_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i), mulDiv255AVX2(d, s));
+    }
+}
+
+__attribute__((target("avx2"))) void scaleAVX2(uchar *dst, int bytes, uchar factor)
+{
+    const __m256i f = _mm256_set1_epi8(static_cast<char>(factor));
+    for (int i = 0; i < bytes; i += 32) {
+        __m256i d = _mm256_load_si256(reinterpret_cast<const __m256i *>(dst + i));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i), mulDiv255AVX2(d, f));
+    }
+}
+
+__attribute__((target("avx2"))) void fadeToBlackAVX2(uchar *dst, int bytes, uchar amount)
+{
+    const __m256i a = _mm256_set1_epi8(static_cast<char>(amount));
+    for (int i = 0; i < bytes; i += 32) {
+        __m256i d = _mm256_load_si256(reinterpret_cast<const __m256i *>(dst + i));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_subs_epu8(d, a));
+    }
+}
+
+const Kernels avx2Kernels = {
+    colorkernels::Implementation::AVX2,
+    blendAlphaAVX2,
+    blendMaskedAVX2,
+    blendAddAVX2,
+    blendMultiplyAVX2,
+    scaleAVX2,
+    fadeToBlackAVX2,
+};
+
+#endif // COLORKERNELS_X86
+
+const Kernels *detectKernels()
+{
+#ifdef COLORKERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return &avx2Kernels;
+    if (__builtin_cpu_supports("sse2"))
+        return &sse2Kernels;
+#endif
+    return &scalarKernels;
+}
+
+std::atomic<const Kernels *> activeKernels { nullptr };
+
+const Kernels *kernels()
+{
+    const Kernels *k = activeKernels.load(std::memory_order_relaxed);
+    if (k == nullptr) {
+        k = detectKernels();
+        activeKernels.store(k, std::memory_order_relaxed);
+    }
+    return k;
+}
+
+/* Number of bytes to process, the SIMD paths work on the padded size */
+int processedBytes(const Framebuffer &fb)
+{
+    if (kernels()->implementation == colorkernels::Implementation::Scalar)
+        return fb.byteCount();
+    return (fb.byteCount() + FRAMEBUFFER_ALIGNMENT - 1) / FRAMEBUFFER_ALIGNMENT * FRAMEBUFFER_ALIGNMENT;
+}
+
+}
+
+void colorkernels::blendAlpha(Framebuffer &dst, const Framebuffer &src, uchar alpha)
+{
+    Q_ASSERT(dst.size() == src.size());
+    kernels()->blendAlpha(dst.bytes(), src.bytes(), processedBytes(dst), alpha);
+}
+
+void colorkernels::blendMasked(Framebuffer &dst, const Framebuffer &src, const Framebuffer &mask)
+{
+    Q_ASSERT(dst.size() == src.size() && dst.size() == mask.size());
+    kernels()->blendMasked(dst.bytes(), src.bytes(), mask.bytes(), processedBytes(dst));
+}
+
+void colorkernels::blendAdd(Framebuffer &dst, const Framebuffer &src)
+{
+    Q_ASSERT(dst.size() == src.size());
+    kernels()->blendAdd(dst.bytes(), src.bytes(), processedBytes(dst));
+}
+
+void colorkernels::blendMultiply(Framebuffer &dst, const Framebuffer &src)
+{
+    Q_ASSERT(dst.size() == src.size());
+    kernels()->blendMultiply(dst.bytes(), src.bytes(), processedBytes(dst));
+}
+
+void colorkernels::scale(Framebuffer &dst, uchar factor)
+{
+    kernels()->scale(dst.bytes(), processedBytes(dst), factor);
+}
+
+void colorkernels::fadeToBlack(Framebuffer &dst, uchar amount)
+{
+    kernels()->fadeToBlack(dst.bytes(), processedBytes(dst), amount);
+}
+
+void colorkernels::fill(Framebuffer &dst, openrazer::RGB color)
+{
+    int bytes = dst.byteCount();
+    if (bytes == 0)
+        return;
+
+    /* Write the first LED and then keep doubling the filled area, which ends
+     * up as a few large memcpy calls instead of one store per LED */
+    uchar *data = dst.bytes();
+    data[0] = color.r;
+    data[1] = color.g;
+    data[2] = color.b;
+    int filled = 3;
+    while (filled < bytes) {
+        int chunk = qMin(filled, bytes - filled);
+        std::memcpy(data + filled, data, chunk);
+        filled += chunk;
+    }
+}
+
+colorkernels::Implementation colorkernels::activeImplementation()
+{
+    return kernels()->implementation;
+}
+
+const char *colorkernels::implementationName(Implementation implementation)
+{
+    switch (implementation) {
+    case Implementation::Scalar:
+        return "scalar";
+    case Implementation::SSE2:
+        return "SSE2";
+    case Implementation::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+void colorkernels::setImplementation(Implementation implementation)
+{
+    const Kernels *k = &scalarKernels;
+#ifdef COLORKERNELS_X86
+    __builtin_cpu_init();
+    if (implementation == Implementation::AVX2 && __builtin_cpu_supports("avx2"))
+        k = &avx2Kernels;
+    else if (implementation == Implementation::SSE2 && __builtin_cpu_supports("sse2"))
+        k = &sse2Kernels;
+#else
+    Q_UNUSED(implementation);
+#endif
+    activeKernels.store(k, std::memory_order_relaxed);
+}
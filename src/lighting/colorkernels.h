@@ -0,0 +1,53 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef COLORKERNELS_H
+#define COLORKERNELS_H
+
+#include "framebuffer.h"
+
+/*
+ * Whole-frame color operations.
+ *
+ * All operations work on every channel of every LED independently, so they
+ * process the framebuffer as a flat byte array. On x86 the best of the
+ * AVX2, SSE2 and scalar implementation is picked at runtime, the results
+ * are identical for all implementations.
+ *
+ * The source and destination framebuffers must have the same dimensions.
+ */
+namespace colorkernels {
+
+enum class Implementation {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/* dst = dst * (255 - alpha) / 255 + src * alpha / 255 */
+void blendAlpha(Framebuffer &dst, const Framebuffer &src, uchar alpha);
+/* Like blendAlpha, but with a separate alpha value for every byte taken from mask */
+void blendMasked(Framebuffer &dst, const Framebuffer &src, const Framebuffer &mask);
+/* dst = min(dst + src, 255) */
+void blendAdd(Framebuffer &dst, const Framebuffer &src);
+/* dst = dst * src / 255 */
+void blendMultiply(Framebuffer &dst, const Framebuffer &src);
+/* dst = dst * factor / 255 */
+void scale(Framebuffer &dst, uchar factor);
+/* dst = max(dst - amount, 0), reaches black after 255 / amount steps */
+void fadeToBlack(Framebuffer &dst, uchar amount);
+/* Set every LED to color */
+void fill(Framebuffer &dst, openrazer::RGB color);
+
+/* The implementation that gets used on this CPU */
+Implementation activeImplementation();
+const char *implementationName(Implementation implementation);
+/* Override the automatically detected implementation, falls back to the
+ * scalar one if the CPU doesn't support the requested one. Used to compare
+ * the implementations against each other. */
+void setImplementation(Implementation implementation);
+
+}
+
+#endif // COLORKERNELS_H
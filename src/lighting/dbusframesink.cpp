@@ -0,0 +1,72 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dbusframesink.h"
+
+#include <QDBusMessage>
+#include <cstring>
+
+DBusFrameSink::DBusFrameSink(const QString &connectionName)
+    : connectionName(connectionName), connection(QDBusConnection::connectToBus(QDBusConnection::SessionBus, connectionName))
+{
+}
+
+DBusFrameSink::~DBusFrameSink()
+{
+    QDBusConnection::disconnectFromBus(connectionName);
+}
+
+bool DBusFrameSink::supports(libopenrazer::Device *device)
+{
+    return dynamic_cast<libopenrazer::openrazer::Device *>(device) != nullptr;
+}
+
+void DBusFrameSink::setObjectPath(const QDBusObjectPath &path)
+{
+    QMutexLocker locker(&mutex);
+    objectPath = path.path();
+}
+
+void DBusFrameSink::defineCustomFrame(int row, int startColumn, int endColumn, const QVector<openrazer::RGB> &colors)
+{
+    // Row, start column, end column followed by the colors
+    payload.resize(3 + colors.size() * 3);
+    payload[0] = static_cast<char>(row);
+    payload[1] = static_cast<char>(startColumn);
+    payload[2] = static_cast<char>(endColumn);
+    std::memcpy(payload.data() + 3, colors.constData(), colors.size() * 3);
+
+    call("setKeyRow", { payload });
+}
+
+void DBusFrameSink::displayCustomFrame()
+{
+    call("setCustom", {});
+}
+
+// setKeyRow takes any number of rows
+bool DBusFrameSink::acceptsPackedRows() const
+{
+    return true;
+}
+
+void DBusFrameSink::defineCustomRows(const QByteArray &packedRows)
+{
+    call("setKeyRow", { packedRows });
+}
+
+void DBusFrameSink::call(const QString &method, const QVariantList &arguments)
+{
+    QString path;
+    {
+        QMutexLocker locker(&mutex);
+        path = objectPath;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall("org.razer", path, "razer.device.lighting.chroma", method);
+    message.setArguments(arguments);
+    QDBusMessage reply = connection.call(message);
+    if (reply.type() == QDBusMessage::ErrorMessage)
+        throw libopenrazer::DBusException(QDBusError(reply));
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBUSFRAMESINK_H
+#define DBUSFRAMESINK_H
+
+#include "framecoalescer.h"
+
+#include <QDBusConnection>
+#include <QMutex>
+#include <libopenrazer.h>
+
+/*
+ * Sends custom frames straight to the OpenRazer daemon, bypassing
+ * libopenrazer.
+ *
+ * libopenrazer sends all calls over the shared session bus connection, so
+ * frames would queue up behind every other call of the application, and it
+ * only takes one row per setKeyRow call although the daemon accepts several.
+ * This sink has a connection of its own and sends all rows of a frame at
+ * once.
+ *
+ * It duplicates what the OpenRazer backend of libopenrazer sends for
+ * defineCustomFrame() and displayCustomFrame(): setKeyRow and setCustom on
+ * the razer.device.lighting.chroma interface. Keep the two in sync. Other
+ * backends have to go through libopenrazer.
+ */
+class DBusFrameSink : public FrameSink
+{
+public:
+    explicit DBusFrameSink(const QString &connectionName);
+    ~DBusFrameSink() override;
+
+    /* Whether device belongs to the backend this sink talks to */
+    static bool supports(libopenrazer::Device *device);
+
+    void setObjectPath(const QDBusObjectPath &path);
+
+    void defineCustomFrame(int row, int startColumn, int endColumn, const QVector<openrazer::RGB> &colors) override;
+    void displayCustomFrame() override;
+    bool acceptsPackedRows() const override;
+    void defineCustomRows(const QByteArray &packedRows) override;
+
+private:
+    void call(const QString &method, const QVariantList &arguments);
+
+    QString connectionName;
+    QDBusConnection connection;
+    QByteArray payload;
+
+    QMutex mutex;
+    QString objectPath;
+};
+
+#endif // DBUSFRAMESINK_H
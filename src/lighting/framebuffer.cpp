@@ -0,0 +1,114 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "framebuffer.h"
+
+#include "colorkernels.h"
+
+#include <cstring>
+#include <new>
+
+static uchar *allocateAligned(int bytes)
+{
+    return static_cast<uchar *>(::operator new(bytes, std::align_val_t(FRAMEBUFFER_ALIGNMENT)));
+}
+
+static void freeAligned(uchar *data)
+{
+    ::operator delete(data, std::align_val_t(FRAMEBUFFER_ALIGNMENT));
+}
+
+Framebuffer::Framebuffer(openrazer::MatrixDimensions dimens)
+{
+    resize(dimens);
+}
+
+Framebuffer::Framebuffer(const Framebuffer &other)
+{
+    *this = other;
+}
+
+Framebuffer::Framebuffer(Framebuffer &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+Framebuffer &Framebuffer::operator=(const Framebuffer &other)
+{
+    if (this == &other)
+        return *this;
+
+    resize({ static_cast<uchar>(other.mRows), static_cast<uchar>(other.mColumns) });
+    if (other.mData != nullptr)
+        std::memcpy(mData, other.mData, byteCount());
+    return *this;
+}
+
+Framebuffer &Framebuffer::operator=(Framebuffer &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    freeAligned(mData);
+    mData = other.mData;
+    mCapacity = other.mCapacity;
+    mRows = other.mRows;
+    mColumns = other.mColumns;
+
+    other.mData = nullptr;
+    other.mCapacity = 0;
+    other.mRows = 0;
+    other.mColumns = 0;
+    return *this;
+}
+
+Framebuffer::~Framebuffer()
+{
+    freeAligned(mData);
+}
+
+void Framebuffer::resize(openrazer::MatrixDimensions dimens)
+{
+    mRows = dimens.x;
+    mColumns = dimens.y;
+
+    // Round up so kernels can always process full chunks
+    int needed = (byteCount() + FRAMEBUFFER_ALIGNMENT - 1) / FRAMEBUFFER_ALIGNMENT * FRAMEBUFFER_ALIGNMENT;
+    if (needed > mCapacity) {
+        freeAligned(mData);
+        mData = allocateAligned(needed);
+        mCapacity = needed;
+    }
+    if (mData != nullptr)
+        std::memset(mData, 0, mCapacity);
+}
+
+void Framebuffer::clear()
+{
+    if (mData != nullptr)
+        std::memset(mData, 0, mCapacity);
+}
+
+void Framebuffer::fill(openrazer::RGB color)
+{
+    colorkernels::fill(*this, color);
+}
+
+void Framebuffer::copyRow(int row, int startColumn, int endColumn, QVector<openrazer::RGB> &out) const
+{
+    int count = endColumn - startColumn + 1;
+    out.resize(count);
+    std::memcpy(out.data(), this->row(row) + startColumn, count * sizeof(openrazer::RGB));
+}
+
+DoubleFramebuffer::DoubleFramebuffer(openrazer::MatrixDimensions dimens)
+{
+    resize(dimens);
+}
+
+void DoubleFramebuffer::resize(openrazer::MatrixDimensions dimens)
+{
+    buffers[0].resize(dimens);
+    buffers[1].resize(dimens);
+}
@@ -0,0 +1,95 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <QVector>
+#include <libopenrazer.h>
+
+static_assert(sizeof(openrazer::RGB) == 3, "openrazer::RGB is expected to be tightly packed");
+
+/*
+ * RGB colors of a LED matrix, stored row by row in one contiguous buffer.
+ *
+ * The buffer is aligned to FRAMEBUFFER_ALIGNMENT bytes and padded to a
+ * multiple of it, so whole-frame operations can work on it in wide chunks.
+ * Resizing to the same or smaller dimensions never allocates.
+ */
+#define FRAMEBUFFER_ALIGNMENT (32)
+
+class Framebuffer
+{
+public:
+    Framebuffer() = default;
+    explicit Framebuffer(openrazer::MatrixDimensions dimens);
+    Framebuffer(const Framebuffer &other);
+    Framebuffer(Framebuffer &&other) noexcept;
+    Framebuffer &operator=(const Framebuffer &other);
+    Framebuffer &operator=(Framebuffer &&other) noexcept;
+    ~Framebuffer();
+
+    void resize(openrazer::MatrixDimensions dimens);
+
+    int rows() const { return mRows; }
+    int columns() const { return mColumns; }
+    /* Number of LEDs */
+    int size() const { return mRows * mColumns; }
+    /* Number of bytes used by the LEDs, without padding */
+    int byteCount() const { return size() * 3; }
+
+    openrazer::RGB *data() { return reinterpret_cast<openrazer::RGB *>(mData); }
+    const openrazer::RGB *data() const { return reinterpret_cast<const openrazer::RGB *>(mData); }
+    uchar *bytes() { return mData; }
+    const uchar *bytes() const { return mData; }
+
+    /* Row views, each row has columns() entries */
+    openrazer::RGB *row(int row) { return data() + row * mColumns; }
+    const openrazer::RGB *row(int row) const { return data() + row * mColumns; }
+
+    openrazer::RGB &at(int row, int column) { return data()[row * mColumns + column]; }
+    const openrazer::RGB &at(int row, int column) const { return data()[row * mColumns + column]; }
+
+    /* Set every LED to black */
+    void clear();
+    void fill(openrazer::RGB color);
+
+    /* Copy the columns startColumn..endColumn (inclusive) of a row into out,
+     * in the shape defineCustomFrame() expects. Reuses the storage of out, so
+     * passing the same vector for every upload doesn't allocate. */
+    void copyRow(int row, int startColumn, int endColumn, QVector<openrazer::RGB> &out) const;
+
+private:
+    uchar *mData = nullptr;
+    int mCapacity = 0; // in bytes
+    int mRows = 0;
+    int mColumns = 0;
+};
+
+/*
+ * Two framebuffers which get swapped after every frame. Render into back()
+ * while front() still holds the previous frame, so producing a new frame
+ * doesn't allocate anything.
+ */
+class DoubleFramebuffer
+{
+public:
+    DoubleFramebuffer() = default;
+    explicit DoubleFramebuffer(openrazer::MatrixDimensions dimens);
+
+    void resize(openrazer::MatrixDimensions dimens);
+
+    Framebuffer &front() { return buffers[current]; }
+    const Framebuffer &front() const { return buffers[current]; }
+    Framebuffer &back() { return buffers[1 - current]; }
+
+    /* Make the back buffer the new front buffer */
+    void swap() { current = 1 - current; }
+
+private:
+    Framebuffer buffers[2];
+    int current = 0;
+};
+
+#endif // FRAMEBUFFER_H
@@ -0,0 +1,174 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "framecoalescer.h"
+
+#include <cstring>
+
+static bool colorsEqual(const openrazer::RGB *a, const openrazer::RGB *b)
+{
+    return a->r == b->r && a->g == b->g && a->b == b->b;
+}
+
+FrameCoalescer::FrameCoalescer(FrameSink *sink, openrazer::MatrixDimensions dimens)
+    : sink(sink), dimens(dimens)
+{
+    dirtySpans.fill({ dimens.y, -1 }, dimens.x);
+    sentColors.resize(dimens);
+    uploadRow.reserve(dimens.y);
+    // Largest possible frame, so packing never allocates
+    packedRows.reserve(dimens.x * (3 + dimens.y * 3));
+    packedSpans.reserve(dimens.x);
+    sentValid.fill(false, dimens.x);
+}
+
+void FrameCoalescer::markDirty(int row, int column)
+{
+    markDirty(row, column, column);
+}
+
+void FrameCoalescer::markDirty(int row, int startColumn, int endColumn)
+{
+    if (row < 0 || row >= dimens.x)
+        return;
+
+    DirtySpan &span = dirtySpans[row];
+    span.start = qMax(0, qMin(span.start, startColumn));
+    span.end = qMin(dimens.y - 1, qMax(span.end, endColumn));
+
+    pending = true;
+    requestedCount++;
+}
+
+void FrameCoalescer::markAllDirty()
+{
+    for (DirtySpan &span : dirtySpans) {
+        span = { 0, dimens.y - 1 };
+    }
+
+    pending = true;
+    requestedCount++;
+}
+
+void FrameCoalescer::invalidate()
+{
+    sentValid.fill(false);
+}
+
+bool FrameCoalescer::hasPendingChanges() const
+{
+    return pending || displayPending;
+}
+
+bool FrameCoalescer::flush(const Framebuffer &frame)
+{
+    if (!hasPendingChanges())
+        return false;
+
+    bool packed = sink->acceptsPackedRows();
+    packedRows.resize(0);
+    packedSpans.clear();
+
+    for (int row = 0; row < dimens.x; row++) {
+        DirtySpan &span = dirtySpans[row];
+        if (!span.isDirty())
+            continue;
+
+        int start = span.start;
+        int end = span.end;
+        const openrazer::RGB *newRow = frame.row(row);
+        const openrazer::RGB *oldRow = sentColors.row(row);
+
+        if (sentValid[row]) {
+            /* Shrink the span to the columns that actually differ from what
+             * the device already shows */
+            while (start <= end && colorsEqual(&newRow[start], &oldRow[start]))
+                start++;
+            while (end >= start && colorsEqual(&newRow[end], &oldRow[end]))
+                end--;
+        } else {
+            /* We don't know what the device shows, send the whole row */
+            start = 0;
+            end = dimens.y - 1;
+        }
+
+        if (start > end) {
+            skippedCount++;
+            span = { dimens.y, -1 };
+            continue;
+        }
+
+        if (packed) {
+            packRow(frame, row, start, end);
+            continue;
+        }
+
+        frame.copyRow(row, start, end, uploadRow);
+        sink->defineCustomFrame(row, start, end, uploadRow);
+        markSent(frame, row, start, end);
+    }
+
+    if (!packedSpans.isEmpty()) {
+        // All rows in one call, they stay dirty if it fails
+        sink->defineCustomRows(packedRows);
+        for (const PackedRow &packedRow : std::as_const(packedSpans)) {
+            markSent(frame, packedRow.row, packedRow.start, packedRow.end);
+        }
+    }
+
+    pending = false;
+
+    if (!displayPending)
+        return false;
+
+    sink->displayCustomFrame();
+    displayPending = false;
+    sentCount++;
+    return true;
+}
+
+/*
+ * Append the columns start..end of a row to packedRows, in the format of
+ * FrameSink::defineCustomRows().
+ */
+void FrameCoalescer::packRow(const Framebuffer &frame, int row, int start, int end)
+{
+    int offset = packedRows.size();
+    int colorBytes = (end - start + 1) * sizeof(openrazer::RGB);
+    packedRows.resize(offset + 3 + colorBytes);
+
+    char *out = packedRows.data() + offset;
+    out[0] = static_cast<char>(row);
+    out[1] = static_cast<char>(start);
+    out[2] = static_cast<char>(end);
+    std::memcpy(out + 3, frame.row(row) + start, colorBytes);
+
+    packedSpans.append({ row, start, end });
+}
+
+/*
+ * Remember that the columns start..end of a row have been uploaded.
+ */
+void FrameCoalescer::markSent(const Framebuffer &frame, int row, int start, int end)
+{
+    std::memcpy(sentColors.row(row) + start, frame.row(row) + start, (end - start + 1) * sizeof(openrazer::RGB));
+    sentValid[row] = true;
+    dirtySpans[row] = { dimens.y, -1 };
+    displayPending = true;
+}
+
+quint64 FrameCoalescer::framesRequested() const
+{
+    return requestedCount;
+}
+
+quint64 FrameCoalescer::framesSent() const
+{
+    return sentCount;
+}
+
+quint64 FrameCoalescer::rowsSkipped() const
+{
+    return skippedCount;
+}
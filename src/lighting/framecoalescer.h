@@ -0,0 +1,106 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FRAMECOALESCER_H
+#define FRAMECOALESCER_H
+
+#include "framebuffer.h"
+
+#include <QByteArray>
+#include <QVector>
+#include <libopenrazer.h>
+
+/*
+ * Receives the uploads of a FrameCoalescer, e.g. a device. Both calls throw
+ * libopenrazer::DBusException on failure.
+ */
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+
+    virtual void defineCustomFrame(int row, int startColumn, int endColumn, const QVector<openrazer::RGB> &colors) = 0;
+    virtual void displayCustomFrame() = 0;
+
+    /* Sinks which can take several rows in one call get all rows of a frame
+     * packed into one buffer instead: for each row its number, start and end
+     * column followed by the colors. */
+    virtual bool acceptsPackedRows() const { return false; }
+    virtual void defineCustomRows(const QByteArray &packedRows) { Q_UNUSED(packedRows) }
+};
+
+/*
+ * Collects changes to a custom frame and uploads them in batches.
+ *
+ * Callers mark the keys they changed with markDirty() and call flush() at
+ * most once per display tick. A flush only uploads the dirty column span of
+ * rows whose contents actually differ from what was sent last, followed by a
+ * single displayCustomFrame(). If the sink allows it, all rows of a flush
+ * are sent in a single call, packed into a buffer that's reused for every
+ * frame.
+ */
+class FrameCoalescer
+{
+public:
+    FrameCoalescer(FrameSink *sink, openrazer::MatrixDimensions dimens);
+
+    /* Mark a single key as changed */
+    void markDirty(int row, int column);
+    /* Mark the columns startColumn..endColumn (inclusive) of a row as changed */
+    void markDirty(int row, int startColumn, int endColumn);
+    /* Mark every key of the matrix as changed */
+    void markAllDirty();
+    /* Forget what has been sent to the device, so that the next flush uploads
+     * all dirty rows even if they look unchanged (e.g. device state unknown) */
+    void invalidate();
+
+    bool hasPendingChanges() const;
+
+    /* Upload the pending changes of frame to the sink. Returns true if a
+     * frame was displayed. Throws libopenrazer::DBusException on failure, the
+     * rows which were not uploaded stay dirty. */
+    bool flush(const Framebuffer &frame);
+
+    /* Number of frame updates requested through markDirty() */
+    quint64 framesRequested() const;
+    /* Number of frames actually displayed on the device */
+    quint64 framesSent() const;
+    /* Number of dirty rows which were skipped because nothing changed */
+    quint64 rowsSkipped() const;
+
+private:
+    struct DirtySpan {
+        int start;
+        int end;
+        bool isDirty() const { return start <= end; }
+    };
+
+    struct PackedRow {
+        int row;
+        int start;
+        int end;
+    };
+
+    void packRow(const Framebuffer &frame, int row, int start, int end);
+    void markSent(const Framebuffer &frame, int row, int start, int end);
+
+    FrameSink *sink;
+    openrazer::MatrixDimensions dimens;
+
+    QVector<DirtySpan> dirtySpans;
+    Framebuffer sentColors;
+    QVector<openrazer::RGB> uploadRow;
+    QByteArray packedRows;
+    /* Rows in packedRows, they're only sent once the buffer is complete */
+    QVector<PackedRow> packedSpans;
+    QVector<bool> sentValid;
+    bool pending = false;
+    bool displayPending = false;
+
+    quint64 requestedCount = 0;
+    quint64 sentCount = 0;
+    quint64 skippedCount = 0;
+};
+
+#endif // FRAMECOALESCER_H
@@ -0,0 +1,196 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "layercompositor.h"
+
+#include "colorkernels.h"
+
+/* Changes to the layers are uploaded at most once per display tick */
+#define FRAME_TICK_MS (16)
+
+LayerCompositor::LayerCompositor(DeviceModel *model, QObject *parent)
+    : QObject(parent), model(model)
+{
+    dimens = model->matrixDimensions();
+
+    for (LayerData &layer : layers) {
+        layer.colors.resize(dimens);
+        layer.mask.resize(dimens);
+    }
+    // Only painted keys cover what's below
+    layers[PaintLayer].hasMask = true;
+
+    output.resize(dimens);
+    scratch.resize(dimens);
+    scratchAlpha.resize(dimens);
+    lightingOutput = new LightingOutput(model, dimens, this);
+    connect(lightingOutput, &LightingOutput::errorOccurred, this, &LayerCompositor::errorOccurred);
+
+    // The daemon has been restarted, show the current frame on the new device
+    connect(model, &DeviceModel::rebound, this, [=]() {
+        {
+            QMutexLocker locker(&mutex);
+            dirty = true;
+        }
+        scheduleTick();
+    });
+
+    tickTimer = new QTimer(this);
+    tickTimer->setSingleShot(true);
+    tickTimer->setInterval(FRAME_TICK_MS);
+    connect(tickTimer, &QTimer::timeout, this, &LayerCompositor::tick);
+}
+
+LayerCompositor::~LayerCompositor() = default;
+
+openrazer::MatrixDimensions LayerCompositor::dimensions() const
+{
+    return dimens;
+}
+
+void LayerCompositor::updateLayer(Layer layer, const std::function<void(Framebuffer &, Framebuffer &)> &update)
+{
+    {
+        QMutexLocker locker(&mutex);
+        update(layers[layer].colors, layers[layer].mask);
+        dirty = true;
+    }
+    scheduleTick();
+}
+
+void LayerCompositor::readLayer(Layer layer, const std::function<void(const Framebuffer &, const Framebuffer &)> &read)
+{
+    QMutexLocker locker(&mutex);
+    read(layers[layer].colors, layers[layer].mask);
+}
+
+void LayerCompositor::setLayerFrame(Layer layer, const Framebuffer &frame)
+{
+    {
+        QMutexLocker locker(&mutex);
+        layers[layer].colors = frame;
+        dirty = true;
+    }
+    scheduleTick();
+}
+
+void LayerCompositor::clearLayer(Layer layer)
+{
+    updateLayer(layer, [](Framebuffer &colors, Framebuffer &mask) {
+        colors.clear();
+        mask.clear();
+    });
+}
+
+void LayerCompositor::setBlendMode(Layer layer, BlendMode mode)
+{
+    {
+        QMutexLocker locker(&mutex);
+        layers[layer].mode = mode;
+        dirty = true;
+    }
+    scheduleTick();
+}
+
+void LayerCompositor::setOpacity(Layer layer, uchar opacity)
+{
+    {
+        QMutexLocker locker(&mutex);
+        layers[layer].opacity = opacity;
+        dirty = true;
+    }
+    scheduleTick();
+}
+
+void LayerCompositor::setActive(bool active)
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (this->active == active)
+            return;
+
+        this->active = active;
+        if (active) {
+            // The device shows something else now, re-send everything
+            lightingOutput->invalidate();
+            dirty = true;
+        }
+    }
+
+    // Don't let queued frames overwrite what replaced the custom frame
+    if (!active)
+        lightingOutput->discardPending();
+
+    if (active) {
+        emit activated();
+        scheduleTick();
+    } else {
+        emit deactivated();
+    }
+}
+
+bool LayerCompositor::isActive() const
+{
+    QMutexLocker locker(&mutex);
+    return active;
+}
+
+void LayerCompositor::tick()
+{
+    QMutexLocker locker(&mutex);
+    if (!active)
+        return;
+
+    if (!dirty)
+        return;
+
+    composite();
+    dirty = false;
+    lightingOutput->submit(output);
+}
+
+void LayerCompositor::scheduleTick()
+{
+    // Layers can get updated from other threads, the timer lives on ours
+    QMetaObject::invokeMethod(this, [=]() {
+        if (!tickTimer->isActive())
+            tickTimer->start();
+    });
+}
+
+/*
+ * Blend all layers from bottom to top into the output frame. Needs the
+ * mutex to be held.
+ */
+void LayerCompositor::composite()
+{
+    output.clear();
+
+    for (const LayerData &layer : layers) {
+        if (layer.opacity == 0)
+            continue;
+
+        // What the layer would look like at full opacity
+        const Framebuffer *result = &layer.colors;
+        if (layer.mode == BlendMode::Add) {
+            scratch = output;
+            colorkernels::blendAdd(scratch, layer.colors);
+            result = &scratch;
+        } else if (layer.mode == BlendMode::Multiply) {
+            scratch = output;
+            colorkernels::blendMultiply(scratch, layer.colors);
+            result = &scratch;
+        }
+
+        if (!layer.hasMask) {
+            colorkernels::blendAlpha(output, *result, layer.opacity);
+        } else if (layer.opacity == 255) {
+            colorkernels::blendMasked(output, *result, layer.mask);
+        } else {
+            scratchAlpha = layer.mask;
+            colorkernels::scale(scratchAlpha, layer.opacity);
+            colorkernels::blendMasked(output, *result, scratchAlpha);
+        }
+    }
+}
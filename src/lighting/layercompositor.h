@@ -0,0 +1,119 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LAYERCOMPOSITOR_H
+#define LAYERCOMPOSITOR_H
+
+#include "devicemodel.h"
+#include "framebuffer.h"
+#include "lightingoutput.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+#include <functional>
+#include <libopenrazer.h>
+
+/*
+ * How a layer gets combined with what's below. The result is blended over
+ * what's below using the opacity of the layer, and the mask where the layer
+ * has one.
+ */
+enum class BlendMode {
+    /* Layer colors replace what's below */
+    Normal,
+    /* Layer colors get added to what's below */
+    Add,
+    /* What's below gets multiplied with the layer colors */
+    Multiply,
+};
+Q_DECLARE_METATYPE(BlendMode)
+
+/*
+ * Stack of lighting layers of a device with the "custom_frame" feature,
+ * composited into the custom frame shown on the device.
+ *
+ * Layers can be modified from any thread. The output is only recomposited
+ * and uploaded on a tick when at least one layer changed, so a static
+ * layout costs nothing while idle. Uploading happens on the I/O thread of
+ * a LightingOutput.
+ */
+class LayerCompositor : public QObject
+{
+    Q_OBJECT
+public:
+    /* Layers from bottom to top */
+    enum Layer {
+        /* Software effect, e.g. from AnimationEngine */
+        BaseLayer,
+        /* Keys painted in the CustomEditor */
+        PaintLayer,
+        LayerCount
+    };
+
+    LayerCompositor(DeviceModel *model, QObject *parent = nullptr);
+    ~LayerCompositor() override;
+
+    openrazer::MatrixDimensions dimensions() const;
+
+    /* Modify the colors and mask of a layer. The mask holds the alpha value
+     * for every channel and is only used by the PaintLayer; keys with mask
+     * {0, 0, 0} are transparent. */
+    void updateLayer(Layer layer, const std::function<void(Framebuffer &colors, Framebuffer &mask)> &update);
+    void readLayer(Layer layer, const std::function<void(const Framebuffer &colors, const Framebuffer &mask)> &read);
+    /* Replace the colors of a layer, the mask is left alone */
+    void setLayerFrame(Layer layer, const Framebuffer &frame);
+    void clearLayer(Layer layer);
+
+    void setBlendMode(Layer layer, BlendMode mode);
+    void setOpacity(Layer layer, uchar opacity);
+
+    /* An inactive compositor doesn't send anything to the device, e.g.
+     * because a hardware effect has been applied in the meantime. Activating
+     * it again re-sends the full frame. */
+    void setActive(bool active);
+    bool isActive() const;
+
+    /* Recomposite and queue the frame for upload if any layer changed. Can
+     * be called from any thread. */
+    void tick();
+
+signals:
+    /* The compositor has been activated and now owns the device lighting */
+    void activated();
+    /* The compositor has been deactivated, e.g. by a hardware effect */
+    void deactivated();
+    /* Uploading a frame failed */
+    void errorOccurred();
+
+private:
+    struct LayerData {
+        Framebuffer colors;
+        Framebuffer mask;
+        BlendMode mode = BlendMode::Normal;
+        uchar opacity = 255;
+        bool hasMask = false;
+    };
+
+    void scheduleTick();
+    void composite();
+
+    DeviceModel *model;
+    openrazer::MatrixDimensions dimens;
+
+    mutable QMutex mutex;
+    LayerData layers[LayerCount];
+    bool dirty = false;
+    bool active = false;
+
+    Framebuffer output;
+    /* Blend result and alpha of the layer being composited */
+    Framebuffer scratch;
+    Framebuffer scratchAlpha;
+    LightingOutput *lightingOutput;
+
+    QTimer *tickTimer;
+};
+
+#endif // LAYERCOMPOSITOR_H
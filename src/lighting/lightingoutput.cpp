@@ -0,0 +1,210 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "lightingoutput.h"
+
+#include "dbusframesink.h"
+
+/*
+ * Goes through libopenrazer, for backends DBusFrameSink doesn't support.
+ */
+class DeviceFrameSink : public FrameSink
+{
+public:
+    DeviceFrameSink(DeviceModel *model)
+        : model(model)
+    {
+    }
+
+    void defineCustomFrame(int row, int startColumn, int endColumn, const QVector<openrazer::RGB> &colors) override
+    {
+        // Copies, the call can outlive this one if it times out
+        model->callDevice([=](libopenrazer::Device *device) {
+            device->defineCustomFrame(row, startColumn, endColumn, colors);
+        });
+    }
+
+    void displayCustomFrame() override
+    {
+        model->callDevice([](libopenrazer::Device *device) {
+            device->displayCustomFrame();
+        });
+    }
+
+private:
+    DeviceModel *model;
+};
+
+/*
+ * Passes the uploads of a frame on to the actual sink, unless the frame has
+ * been discarded in the meantime.
+ */
+class DiscardableSink : public FrameSink
+{
+public:
+    DiscardableSink(FrameSink *sink, const std::atomic<int> &generation)
+        : sink(sink), generation(generation)
+    {
+    }
+
+    /* The generation of the frame being uploaded */
+    void setFrameGeneration(int frameGeneration)
+    {
+        this->frameGeneration = frameGeneration;
+    }
+
+    void defineCustomFrame(int row, int startColumn, int endColumn, const QVector<openrazer::RGB> &colors) override
+    {
+        if (isCurrent())
+            sink->defineCustomFrame(row, startColumn, endColumn, colors);
+    }
+
+    void displayCustomFrame() override
+    {
+        if (isCurrent())
+            sink->displayCustomFrame();
+    }
+
+    bool acceptsPackedRows() const override
+    {
+        return sink->acceptsPackedRows();
+    }
+
+    void defineCustomRows(const QByteArray &packedRows) override
+    {
+        if (isCurrent())
+            sink->defineCustomRows(packedRows);
+    }
+
+private:
+    bool isCurrent() const
+    {
+        return generation == frameGeneration;
+    }
+
+    FrameSink *sink;
+    const std::atomic<int> &generation;
+    int frameGeneration = 0;
+};
+
+LightingOutput::LightingOutput(DeviceModel *model, openrazer::MatrixDimensions dimens, QObject *parent)
+    : QObject(parent), model(model)
+{
+    if (DBusFrameSink::supports(model->device())) {
+        auto *dbusSink = new DBusFrameSink(QString("razergenie-lighting-%1").arg(reinterpret_cast<quintptr>(this), 0, 16));
+        dbusSink->setObjectPath(model->objectPath());
+        sink = dbusSink;
+    } else {
+        sink = new DeviceFrameSink(model);
+    }
+    // Skipped uploads leave the coalescer out of sync with the device, but
+    // the compositor invalidates the output before sending again
+    discardableSink = new DiscardableSink(sink, generation);
+    frameCoalescer = new FrameCoalescer(discardableSink, dimens);
+
+    for (Framebuffer &frame : queue) {
+        frame.resize(dimens);
+    }
+    current.resize(dimens);
+
+    // The daemon has been restarted, the device might have a new path
+    connect(model, &DeviceModel::rebound, this, &LightingOutput::rebind);
+
+    worker = new QObject();
+    worker->moveToThread(&thread);
+    thread.setObjectName("LightingOutput");
+    thread.start();
+}
+
+LightingOutput::~LightingOutput()
+{
+    discardPending();
+    thread.quit();
+    thread.wait();
+    delete worker;
+    delete frameCoalescer;
+    delete discardableSink;
+    delete sink;
+}
+
+void LightingOutput::submit(const Framebuffer &frame)
+{
+    QMutexLocker locker(&mutex);
+    if (queueCount == LIGHTING_OUTPUT_QUEUE_LENGTH) {
+        // The device is behind, replace the newest frame that hasn't been sent
+        queue[(queueStart + queueCount - 1) % LIGHTING_OUTPUT_QUEUE_LENGTH] = frame;
+    } else {
+        queue[(queueStart + queueCount) % LIGHTING_OUTPUT_QUEUE_LENGTH] = frame;
+        queueCount++;
+    }
+
+    if (!draining) {
+        draining = true;
+        QMetaObject::invokeMethod(worker, [=]() { drain(); });
+    }
+}
+
+void LightingOutput::discardPending()
+{
+    QMutexLocker locker(&mutex);
+    queueCount = 0;
+    generation++;
+}
+
+void LightingOutput::invalidate()
+{
+    QMutexLocker locker(&mutex);
+    invalidatePending = true;
+}
+
+/*
+ * Upload the queued frames, runs on the I/O thread.
+ */
+void LightingOutput::drain()
+{
+    while (true) {
+        {
+            QMutexLocker locker(&mutex);
+            if (queueCount == 0) {
+                draining = false;
+                return;
+            }
+
+            // Swap instead of copying, the storage gets reused for later frames
+            std::swap(current, queue[queueStart]);
+            queueStart = (queueStart + 1) % LIGHTING_OUTPUT_QUEUE_LENGTH;
+            queueCount--;
+            discardableSink->setFrameGeneration(generation);
+
+            if (invalidatePending) {
+                frameCoalescer->invalidate();
+                invalidatePending = false;
+            }
+        }
+
+        // DBusFrameSink doesn't go through the model, so don't let it pile
+        // up calls on a device which doesn't respond. What it shows after
+        // recovering is unknown.
+        if (!model->isResponsive()) {
+            frameCoalescer->invalidate();
+            continue;
+        }
+
+        // Only rows which differ from the last uploaded frame get sent
+        frameCoalescer->markAllDirty();
+        try {
+            frameCoalescer->flush(current);
+        } catch (const libopenrazer::DBusException &e) {
+            qWarning("Failed to upload custom frame");
+            emit errorOccurred();
+        }
+    }
+}
+
+void LightingOutput::rebind()
+{
+    if (auto *dbusSink = dynamic_cast<DBusFrameSink *>(sink))
+        dbusSink->setObjectPath(model->objectPath());
+    invalidate();
+}
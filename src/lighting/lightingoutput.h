@@ -0,0 +1,80 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef LIGHTINGOUTPUT_H
+#define LIGHTINGOUTPUT_H
+
+#include "devicemodel.h"
+#include "framebuffer.h"
+#include "framecoalescer.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <libopenrazer.h>
+
+/* Frames waiting for the I/O thread, older ones get replaced when full */
+#define LIGHTING_OUTPUT_QUEUE_LENGTH (2)
+
+class DiscardableSink;
+
+/*
+ * Uploads custom frames to a device from a dedicated I/O thread.
+ *
+ * Frames are handed over through a short queue, so neither a busy GUI thread
+ * (dialogs, layouts, ...) delays the lighting, nor does a slow device stall
+ * whoever renders the frames. When the device can't keep up, the newest
+ * queued frame gets replaced instead of the queue growing.
+ *
+ * With the OpenRazer backend the frames are sent by a DBusFrameSink over a
+ * D-Bus connection of their own, so they don't queue up behind the other
+ * calls of the application on the shared session bus connection.
+ */
+class LightingOutput : public QObject
+{
+    Q_OBJECT
+public:
+    LightingOutput(DeviceModel *model, openrazer::MatrixDimensions dimens, QObject *parent = nullptr);
+    ~LightingOutput() override;
+
+    /* Queue frame for upload. Can be called from any thread, doesn't block
+     * on the device. */
+    void submit(const Framebuffer &frame);
+    /* Drop the queued frames and the rest of the one being uploaded. Doesn't
+     * wait, a call to the device which is running already still completes. */
+    void discardPending();
+    /* Forget what has been sent to the device, so the next frame gets sent
+     * completely */
+    void invalidate();
+
+signals:
+    /* Uploading a frame failed */
+    void errorOccurred();
+
+private:
+    void drain();
+    void rebind();
+
+    DeviceModel *model;
+    QThread thread;
+    /* Lives on the I/O thread, everything it runs uses the members below */
+    QObject *worker;
+    FrameSink *sink;
+    DiscardableSink *discardableSink;
+    FrameCoalescer *frameCoalescer;
+    Framebuffer current;
+
+    QMutex mutex;
+    /* Incremented by discardPending(), frames of older generations don't get
+     * sent anymore */
+    std::atomic<int> generation { 0 };
+    Framebuffer queue[LIGHTING_OUTPUT_QUEUE_LENGTH];
+    int queueStart = 0;
+    int queueCount = 0;
+    bool draining = false;
+    bool invalidatePending = false;
+};
+
+#endif // LIGHTINGOUTPUT_H
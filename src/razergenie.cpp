@@ -4,10 +4,13 @@
 
 #include "razergenie.h"
 
+#include "asyncread.h"
 #include "devicelistwidget.h"
 #include "devicewidget/devicewidget.h"
 #include "preferences/preferences.h"
 #include "razerimagedownloader.h"
+#include "supporteddeviceindex.h"
+#include "usbscanner.h"
 #include "util.h"
 
 #include <QDBusServiceWatcher>
@@ -19,6 +22,17 @@ const char *supportedDevicesUrl = "https://github.com/openrazer/openrazer/blob/m
 const char *troubleshootingUrl = "https://github.com/openrazer/openrazer/wiki/Troubleshooting";
 const char *websiteUrl = "https://openrazer.github.io/";
 
+/* Device pages which haven't been shown for the longest time get torn down
+ * when more than this many are built */
+#define MAX_BUILT_DEVICE_PAGES (4)
+
+/* Signals arriving within this time get handled together, e.g. when a hub
+ * with multiple devices gets plugged in */
+#define DEVICES_CHANGED_DELAY_MS (200)
+/* Full comparison with the daemon in case a signal got lost, also drops
+ * the cached state of the devices */
+#define DEVICE_RESCAN_INTERVAL_MS (60 * 1000)
+
 RazerGenie::RazerGenie(QWidget *parent)
     : QWidget(parent)
 {
@@ -138,10 +152,12 @@ RazerGenie::RazerGenie(QWidget *parent)
 
 RazerGenie::~RazerGenie()
 {
-    QHashIterator<QDBusObjectPath, libopenrazer::Device *> i(devices);
+    QHashIterator<QDBusObjectPath, DeviceEntry> i(devices);
     while (i.hasNext()) {
         i.next();
-        delete i.value();
+        // The widgets of the page use the model until they're gone
+        delete i.value().page;
+        delete i.value().model;
     }
 }
 
@@ -161,6 +177,23 @@ void RazerGenie::setupUi()
     ui_main.screensaverCheckBox->setChecked(manager->getTurnOffOnScreensaver());
 
     connect(ui_main.listWidget, &QListWidget::currentRowChanged, ui_main.stackedWidget, &QStackedWidget::setCurrentIndex);
+    connect(ui_main.stackedWidget, &QStackedWidget::currentChanged, this, &RazerGenie::buildDevicePage);
+
+    devicesChangedTimer = new QTimer(this);
+    devicesChangedTimer->setSingleShot(true);
+    devicesChangedTimer->setInterval(DEVICES_CHANGED_DELAY_MS);
+    connect(devicesChangedTimer, &QTimer::timeout, this, [=]() {
+        refreshDeviceList(false);
+    });
+
+    rescanTimer = new QTimer(this);
+    rescanTimer->setInterval(DEVICE_RESCAN_INTERVAL_MS);
+    connect(rescanTimer, &QTimer::timeout, this, [=]() {
+        // Also picks up devices which got reconnected in a different state
+        // while their object path stayed the same
+        refreshDeviceList(true);
+    });
+    rescanTimer->start();
 
     manager->connectDevicesChanged(this, SLOT(devicesChanged()));
 }
@@ -168,184 +201,329 @@ void RazerGenie::setupUi()
 void RazerGenie::dbusServiceRegistered(const QString &serviceName)
 {
     qInfo() << "Registered! " << serviceName;
-    fillDeviceList();
+    reattachDeviceList();
+    ui_main.stackedWidget->setEnabled(true);
+    rescanTimer->start();
     util::showInfo(tr("The D-Bus connection was re-established."));
 }
 
 void RazerGenie::dbusServiceUnregistered(const QString &serviceName)
 {
     qInfo() << "Unregistered! " << serviceName;
-    clearDeviceList();
+    devicesChangedTimer->stop();
+    rescanTimer->stop();
+    // Keep the device pages around, they get reattached to the devices once
+    // the daemon is back
+    ui_main.stackedWidget->setEnabled(false);
     // TODO: Show another placeholder screen with information that the daemon has been stopped?
     util::showError(tr("The D-Bus connection was lost, which probably means that the daemon has crashed."));
 }
 
-/**
- * Returns a list of connected devices, which are detected by Linux / lsusb. VID and PID are in decimal form.
- */
-QList<QPair<int, int>> RazerGenie::getConnectedDevices_lsusb()
-{
-    // Get list of Razer devices connected to the PC: lsusb | grep '1532:' | cut -d' ' -f6
-    QProcess process;
-    process.start("bash", QStringList() << "-c"
-                                        << "lsusb | grep '1532:' | cut -d' ' -f6");
-    process.waitForFinished();
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
-    QStringList outputList = QString(process.readAllStandardOutput()).split("\n", Qt::SkipEmptyParts);
-#else
-    QStringList outputList = QString(process.readAllStandardOutput()).split("\n", QString::SkipEmptyParts);
-#endif
-
-    QList<QPair<int, int>> returnList;
-
-    // Transform the list ["1234:abcd", "5678:def0"] into a QList with QPairs.
-    QStringListIterator i(outputList);
-    while (i.hasNext()) {
-        QStringList split = i.next().split(":");
-        bool ok;
-        // TODO: Check if count is 2? Otherwise SIGSEGV probably
-        int vid = split[0].toInt(&ok, 16);
-        int pid = split[1].toInt(&ok, 16);
-        if (!ok) {
-            qWarning() << "RazerGenie: Error while parsing the lsusb output.";
-            return QList<QPair<int, int>>();
-        }
-        returnList.append(qMakePair(vid, pid));
-    }
-    return returnList;
-}
-
 void RazerGenie::fillDeviceList()
 {
     // Get all connected devices
     QList<QDBusObjectPath> devicePaths = manager->getDevices();
 
+    beginDeviceListUpdate();
+
     // Iterate through all devices
     for (const QDBusObjectPath &devicePath : devicePaths) {
-        addDeviceToGui(devicePath);
+        addDeviceToGui(devicePath, manager->getDevice(devicePath));
     }
 
-    if (devicePaths.size() == 0) {
-        // Add placeholder widget
-        ui_main.stackedWidget->addWidget(getNoDevicePlaceholder());
-    }
+    endDeviceListUpdate();
 }
 
-void RazerGenie::refreshDeviceList()
+/*
+ * Compare the devices known to the daemon with the ones in the list and only
+ * add/remove the difference, as one update of the UI. The state cached for
+ * the devices which stay gets dropped if invalidateKept is set. The
+ * devicesChanged signal doesn't tell which device changed, so doing that on
+ * every signal would make all devices read their state again.
+ */
+void RazerGenie::refreshDeviceList(bool invalidateKept)
 {
-    // LOGIC:
-    // - list of current
-    // - hash of old
-    // go through old
-    // if still in new, remove from new list
-    // if not in new, remove from both
-    // go through new (remaining items) list and add
-    QList<QDBusObjectPath> devicePaths = manager->getDevices();
-    QMutableHashIterator<QDBusObjectPath, libopenrazer::Device *> i(devices);
-    while (i.hasNext()) {
-        i.next();
-        if (devicePaths.contains(i.key())) {
-            qDebug() << "Keep: " << i.key().path();
-            devicePaths.removeOne(i.key());
+    QList<QDBusObjectPath> devicePaths;
+    try {
+        devicePaths = manager->getDevices();
+    } catch (const libopenrazer::DBusException &e) {
+        qWarning("Failed to get devices");
+        return;
+    }
+    QSet<QDBusObjectPath> currentPaths(devicePaths.constBegin(), devicePaths.constEnd());
+
+    QList<QDBusObjectPath> removedPaths;
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        if (currentPaths.contains(it.key())) {
+            // The device might have been reconnected with a different state
+            if (invalidateKept)
+                it->model->invalidateState();
         } else {
-            libopenrazer::Device *dev = i.value();
-            qDebug() << "Remove: " << i.key().path();
-            devicePaths.removeOne(i.key());
-            removeDeviceFromGui(i.key());
-            devices.remove(i.key());
-            delete dev;
+            removedPaths.append(it.key());
         }
     }
-    QListIterator<QDBusObjectPath> j(devicePaths);
-    while (j.hasNext()) {
-        QDBusObjectPath devicePath = j.next();
-        qDebug() << "Add: " << devicePath.path();
-        addDeviceToGui(devicePath);
+
+    beginDeviceListUpdate();
+
+    for (const QDBusObjectPath &devicePath : std::as_const(removedPaths)) {
+        qDebug() << "Remove: " << devicePath.path();
+        removeDeviceFromGui(devicePath);
+    }
+
+    // Keep the order of the daemon for new devices
+    for (const QDBusObjectPath &devicePath : std::as_const(devicePaths)) {
+        if (!devices.contains(devicePath)) {
+            qDebug() << "Add: " << devicePath.path();
+            addDeviceToGui(devicePath, manager->getDevice(devicePath));
+        }
     }
+
+    endDeviceListUpdate();
 }
 
-void RazerGenie::clearDeviceList()
+/*
+ * After the daemon has been restarted, rebind the existing device pages to
+ * the new device objects by their serial instead of building them again.
+ * The models restore the lighting applied previously.
+ */
+void RazerGenie::reattachDeviceList()
 {
-    // Clear devices QHash
-    devices.clear();
-    // Clear device list
-    ui_main.listWidget->clear();
-    // Clear stackedwidget
-    for (int i = ui_main.stackedWidget->count(); i >= 0; i--) {
-        QWidget *widget = ui_main.stackedWidget->widget(i);
-        ui_main.stackedWidget->removeWidget(widget);
-        widget->deleteLater();
+    QList<QDBusObjectPath> devicePaths;
+    try {
+        devicePaths = manager->getDevices();
+    } catch (const libopenrazer::DBusException &e) {
+        qWarning("Failed to get devices");
+        return;
+    }
+
+    QHash<QString, QDBusObjectPath> pathsBySerial;
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        if (!it->serial.isEmpty())
+            pathsBySerial.insert(it->serial, it.key());
     }
-    // Add placeholder widget
-    // TODO: Add placeholder widget with crash information and link to bug report?
-    ui_main.stackedWidget->addWidget(getNoDevicePlaceholder());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QHash<QDBusObjectPath, DeviceEntry> reattached;
+    QList<QPair<QDBusObjectPath, libopenrazer::Device *>> added;
+    for (const QDBusObjectPath &devicePath : std::as_const(devicePaths)) {
+        libopenrazer::Device *device = manager->getDevice(devicePath);
+
+        QString serial;
+        try {
+            serial = device->getSerial();
+        } catch (const libopenrazer::DBusException &e) {
+            qWarning("Failed to get serial");
+        }
+
+        // Devices without serial can only be found again by object path
+        auto it = devices.find(pathsBySerial.value(serial, devicePath));
+        if (it == devices.end() || (!serial.isEmpty() && it->serial != serial)) {
+            added.append(qMakePair(devicePath, device));
+            continue;
+        }
+
+        DeviceEntry entry = it.value();
+        devices.erase(it);
+        entry.model->rebind(device);
+        entry.serial = serial;
+        reattached.insert(devicePath, entry);
+    }
+
+    beginDeviceListUpdate();
+
+    // What's left has disappeared while the daemon was gone
+    const QList<QDBusObjectPath> removedPaths = devices.keys();
+    for (const QDBusObjectPath &devicePath : removedPaths) {
+        qDebug() << "Remove: " << devicePath.path();
+        removeDeviceFromGui(devicePath);
+    }
+
+    // The pages of these stay as they are
+    devices.insert(reattached);
+
+    for (const auto &device : std::as_const(added)) {
+        qDebug() << "Add: " << device.first.path();
+        addDeviceToGui(device.first, device.second);
+    }
+
+    endDeviceListUpdate();
+
+    qDebug() << "Reattached" << reattached.size() << "devices in" << timer.elapsed() << "ms";
 }
 
-void RazerGenie::addDeviceToGui(const QDBusObjectPath &devicePath)
+/*
+ * Adding and removing devices between these doesn't repaint the list or
+ * build the pages which are current just for a moment.
+ */
+void RazerGenie::beginDeviceListUpdate()
 {
-    // Create device instance with current serial
-    libopenrazer::Device *currentDevice = manager->getDevice(devicePath);
-
-    if (devices.isEmpty()) {
-        // Remove placeholder widget if inserted.
-        QWidget *widget = ui_main.stackedWidget->widget(0);
-        if (widget != nullptr)
-            ui_main.stackedWidget->removeWidget(widget);
-    }
+    ui_main.listWidget->setUpdatesEnabled(false);
+    ui_main.stackedWidget->setUpdatesEnabled(false);
+    ui_main.stackedWidget->blockSignals(true);
+}
 
-    // Add new device to the list
-    auto *listItem = new QListWidgetItem();
-    listItem->setSizeHint(QSize(/* any small width */ 1, 120));
-    ui_main.listWidget->addItem(listItem);
-    auto *listItemWidget = new DeviceListWidget(ui_main.listWidget, currentDevice);
-    ui_main.listWidget->setItemWidget(listItem, listItemWidget);
-
-    // Insert current device pointer with serial lookup into a QHash
-    devices.insert(devicePath, currentDevice);
-
-    // Download image for device
-    if (!currentDevice->getDeviceImageUrl().isEmpty()) {
-        RazerImageDownloader *dl = new RazerImageDownloader(QUrl(currentDevice->getDeviceImageUrl()), this);
-        connect(dl, &RazerImageDownloader::downloadFinished, listItemWidget, &DeviceListWidget::imageDownloaded);
-        connect(dl, &RazerImageDownloader::downloadErrored, listItemWidget, &DeviceListWidget::imageDownloadErrored);
-        dl->startDownload();
-    } else {
-        qWarning() << "Device image for" << currentDevice->getDeviceName() << "is missing.";
-        listItemWidget->setNoImage();
+void RazerGenie::endDeviceListUpdate()
+{
+    bool placeholderShown = noDevicePlaceholder != nullptr && ui_main.stackedWidget->indexOf(noDevicePlaceholder) != -1;
+    if (devices.isEmpty() && !placeholderShown) {
+        // Add placeholder widget
+        ui_main.stackedWidget->addWidget(getNoDevicePlaceholder());
+    } else if (!devices.isEmpty() && placeholderShown) {
+        // Remove placeholder widget
+        ui_main.stackedWidget->removeWidget(noDevicePlaceholder);
     }
 
-    /* Create actual DeviceWidget */
-    auto *widget = new DeviceWidget(currentDevice);
+    ui_main.stackedWidget->blockSignals(false);
+    buildDevicePage(ui_main.stackedWidget->currentIndex());
+    ui_main.stackedWidget->setUpdatesEnabled(true);
+    ui_main.listWidget->setUpdatesEnabled(true);
+}
+
+void RazerGenie::addDeviceToGui(const QDBusObjectPath &devicePath, libopenrazer::Device *device)
+{
+    DeviceEntry entry;
+
+    // The model caches everything read from the device
+    entry.model = new DeviceModel(device);
 
-    // Add the new widget to the stacked widget
-    ui_main.stackedWidget->addWidget(widget);
+    // Add new device to the list
+    entry.listItem = new QListWidgetItem();
+    entry.listItem->setSizeHint(QSize(/* any small width */ 1, 120));
+    ui_main.listWidget->addItem(entry.listItem);
+    auto *listItemWidget = new DeviceListWidget(ui_main.listWidget, entry.model);
+    ui_main.listWidget->setItemWidget(entry.listItem, listItemWidget);
+
+    // Download image for device, none of the reads may block the GUI as the
+    // device might not respond
+    DeviceModel *model = entry.model;
+    util::readAsync<QString>(
+            model->readPool(), listItemWidget, [=]() { return model->imageUrl(); }, QString(), "Failed to get device image url",
+            [=](const QString &imageUrl) {
+                if (!imageUrl.isEmpty()) {
+                    RazerImageDownloader::instance()->fetch(
+                            QUrl(imageUrl), listItemWidget,
+                            [=](QString &filename) { listItemWidget->imageDownloaded(filename); },
+                            [=](QString reason, QString longReason) { listItemWidget->imageDownloadErrored(reason, longReason); });
+                } else {
+                    qWarning() << "Device image for" << devicePath.path() << "is missing.";
+                    listItemWidget->setNoImage();
+                }
+            });
+
+    // For finding the device again after a daemon restart
+    util::readAsync<QString>(
+            model->readPool(), this, [=]() { return model->serial(); }, QString(), "Failed to get serial",
+            [=](const QString &serial) {
+                auto it = devices.find(devicePath);
+                if (it != devices.end() && it->model == model)
+                    it->serial = serial;
+            });
+
+    /* Create the page, the actual DeviceWidget gets built once it's shown */
+    entry.page = new QWidget();
+    auto *pageLayout = new QVBoxLayout(entry.page);
+    pageLayout->setContentsMargins(0, 0, 0, 0);
+
+    // Add the new page to the stacked widget
+    ui_main.stackedWidget->addWidget(entry.page);
+
+    // Calls to an unresponsive device fail right away, show why
+    connect(entry.model, &DeviceModel::responsiveChanged, entry.page, [=](bool responsive) {
+        listItemWidget->setToolTip(responsive ? QString() : tr("The device is not responding, e.g. because it's asleep."));
+        entry.page->setEnabled(responsive);
+        // Building the page might have failed in the meantime
+        if (responsive && ui_main.stackedWidget->currentWidget() == entry.page)
+            buildDevicePage(ui_main.stackedWidget->currentIndex());
+    });
+
+    // Insert the device with object path lookup into a QHash
+    devices.insert(devicePath, entry);
+    devicePages.insert(entry.page, entry.model);
 }
 
 bool RazerGenie::removeDeviceFromGui(const QDBusObjectPath &devicePath)
 {
-    int index = -1;
-    for (int i = 0; i < ui_main.listWidget->count(); i++) {
-        // get item for index
-        QListWidgetItem *item = ui_main.listWidget->item(i);
-        // get itemwidget for the item
-        auto *widget = dynamic_cast<DeviceListWidget *>(ui_main.listWidget->itemWidget(item));
-        // compare serial
-        if (widget->device()->objectPath() == devicePath) {
-            index = i;
-            break;
-        }
-    }
-    if (index == -1) {
+    auto it = devices.find(devicePath);
+    if (it == devices.end()) {
         return false;
     }
-    ui_main.stackedWidget->removeWidget(ui_main.stackedWidget->widget(index));
-    delete ui_main.listWidget->takeItem(index);
+    DeviceEntry entry = it.value();
+    devices.erase(it);
+
+    devicePages.remove(entry.page);
+    builtPages.removeOne(entry.page);
+    ui_main.stackedWidget->removeWidget(entry.page);
+    delete entry.page;
+    // Looks up the row through the position remembered by the item
+    delete ui_main.listWidget->takeItem(ui_main.listWidget->indexFromItem(entry.listItem).row());
+    delete entry.model;
+    return true;
+}
 
-    // Add placeholder widget if the stackedWidget is empty after removing.
-    if (devices.isEmpty()) {
-        ui_main.stackedWidget->addWidget(getNoDevicePlaceholder());
+/*
+ * Build the DeviceWidget of the page at index if it's a device page that
+ * hasn't been built yet, and tear down the pages not shown for the longest
+ * time if too many are built.
+ *
+ * What the page needs is read from the device in the background first, so
+ * a device which is slow or asleep doesn't freeze the window.
+ */
+void RazerGenie::buildDevicePage(int index)
+{
+    QWidget *page = ui_main.stackedWidget->widget(index);
+    DeviceModel *model = devicePages.value(page);
+    if (model == nullptr)
+        return;
+
+    if (builtPages.removeOne(page)) {
+        builtPages.append(page);
+        return;
+    }
+
+    // Still reading
+    if (page->property("loading").toBool())
+        return;
+    page->setProperty("loading", true);
+
+    // Left over from a previous attempt
+    delete page->findChild<QLabel *>(QString(), Qt::FindDirectChildrenOnly);
+
+    util::readAsync<bool>(
+            model->readPool(), page, [=]() { DeviceWidget::preload(model); return true; }, false, "Failed to read device properties",
+            [=](const bool &loaded) {
+                page->setProperty("loading", false);
+                if (!loaded) {
+                    page->layout()->addWidget(new QLabel(tr("The device didn't respond."), page));
+                    return;
+                }
+                finishDevicePage(page, model);
+            });
+}
+
+void RazerGenie::finishDevicePage(QWidget *page, DeviceModel *model)
+{
+    try {
+        page->layout()->addWidget(new DeviceWidget(model));
+    } catch (const libopenrazer::DBusException &e) {
+        // Cached values can expire in the meantime, e.g. after a hotplug
+        qWarning("Failed to build device page");
+        page->layout()->addWidget(new QLabel(tr("The device didn't respond."), page));
+        return;
+    }
+    builtPages.append(page);
+
+    for (int i = 0; i < builtPages.size() - 1 && builtPages.size() > MAX_BUILT_DEVICE_PAGES;) {
+        auto *widget = builtPages[i]->findChild<DeviceWidget *>(QString(), Qt::FindDirectChildrenOnly);
+        if (widget->isInUse()) {
+            i++;
+            continue;
+        }
+        qDebug() << "Tearing down device page" << ui_main.stackedWidget->indexOf(builtPages[i]);
+        delete widget;
+        builtPages.removeAt(i);
     }
-    return true;
 }
 
 QWidget *RazerGenie::getNoDevicePlaceholder()
@@ -355,31 +533,18 @@ QWidget *RazerGenie::getNoDevicePlaceholder()
     }
     // Generate placeholder widget with text "No device is connected.". Maybe add a usb pid check - at least add link to readme and troubleshooting page. Maybe add support for the future daemon troubleshooting option.
 
-    QList<QPair<int, int>> connectedDevices = getConnectedDevices_lsusb();
+    // VID and PID of the connected Razer devices
+    QList<QPair<int, int>> connectedDevices = UsbScanner().connectedDevices(0x1532);
     QList<QPair<int, int>> matches;
 
-    // Don't even iterate if there are no devices detected by lsusb.
+    // Don't even load the index if there are no devices detected by Linux.
     if (connectedDevices.count() != 0) {
-        QHashIterator<QString, QVariant> i(manager->getSupportedDevices());
-        // Iterate through the supported devices
-        while (i.hasNext()) {
-            i.next();
-            QList<QVariant> list = i.value().toList();
-            if (list.count() != 2) {
-                qWarning() << "RazerGenie: Error while iterating through supportedDevices";
-                qWarning() << list;
-                continue;
-            }
-            int vid = list[0].toInt();
-            int pid = list[1].toInt();
-
-            QListIterator<QPair<int, int>> j(connectedDevices);
-            while (j.hasNext()) {
-                QPair<int, int> x = j.next();
-                if (x.first == vid && x.second == pid) {
-                    qDebug() << "Found a device match!";
-                    matches.append(x);
-                }
+        QString daemonId = settings.value("backend").toString() + " " + manager->getDaemonVersion();
+        SupportedDeviceIndex supportedDevices = SupportedDeviceIndex::load(manager, daemonId);
+        for (const QPair<int, int> &device : std::as_const(connectedDevices)) {
+            if (supportedDevices.contains(device.first, device.second)) {
+                qDebug() << "Found a device match!";
+                matches.append(device);
             }
         }
     }
@@ -448,8 +613,10 @@ void RazerGenie::openPreferences()
 
 void RazerGenie::devicesChanged()
 {
+    // The signals don't tell which device changed, only compare the list of
+    // devices once the burst of signals is over
     qInfo() << "DEVICE HAVE CHANGED!";
-    refreshDeviceList();
+    devicesChangedTimer->start();
 }
 
 void RazerGenie::openIssueUrl()
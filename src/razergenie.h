@@ -5,9 +5,11 @@
 #ifndef RAZERGENIE_H
 #define RAZERGENIE_H
 
+#include "devicemodel.h"
 #include "ui_razergenie.h"
 
 #include <QSettings>
+#include <QTimer>
 #include <libopenrazer.h>
 
 class RazerGenie : public QWidget
@@ -40,21 +42,37 @@ private:
 
     QWidget *noDevicePlaceholder = nullptr;
 
-    QList<QPair<int, int>> getConnectedDevices_lsusb();
-
     void fillDeviceList();
-    void refreshDeviceList();
-    void clearDeviceList();
+    void refreshDeviceList(bool invalidateKept);
+    void reattachDeviceList();
 
-    void addDeviceToGui(const QDBusObjectPath &devicePath);
+    void beginDeviceListUpdate();
+    void endDeviceListUpdate();
+    void addDeviceToGui(const QDBusObjectPath &devicePath, libopenrazer::Device *device);
     bool removeDeviceFromGui(const QDBusObjectPath &devicePath);
+    void buildDevicePage(int index);
+    void finishDevicePage(QWidget *page, DeviceModel *model);
     QWidget *getNoDevicePlaceholder();
 
     void getRazerDevices();
 
-    QHash<QDBusObjectPath, libopenrazer::Device *> devices;
+    struct DeviceEntry {
+        DeviceModel *model;
+        QString serial;
+        QListWidgetItem *listItem;
+        /* Page in the stacked widget */
+        QWidget *page;
+    };
+    QHash<QDBusObjectPath, DeviceEntry> devices;
+    /* Stacked widget pages, the DeviceWidget inside gets built when shown */
+    QHash<QWidget *, DeviceModel *> devicePages;
+    /* Pages with a DeviceWidget, least recently shown first */
+    QList<QWidget *> builtPages;
     libopenrazer::Manager *manager;
 
+    QTimer *devicesChangedTimer = nullptr;
+    QTimer *rescanTimer = nullptr;
+
     QSettings settings;
 };
 
@@ -4,67 +4,292 @@
 
 #include "razerimagedownloader.h"
 
+#include <QApplication>
 #include <QDir>
 #include <QFileInfo>
+#include <QJsonDocument>
 #include <QStandardPaths>
+#include <QtConcurrent>
 
-RazerImageDownloader::RazerImageDownloader(QUrl url, QObject *parent)
-    : QObject(parent)
+/* Downloads running at the same time, more get queued */
+#define MAX_CONCURRENT_DOWNLOADS (2)
+
+RazerImageDownloader::RazerImageDownloader(QNetworkAccessManager *network, const QString &downloadPath, QObject *parent)
+    : QObject(parent), network(network), downloadPath(downloadPath)
 {
-    manager = new QNetworkAccessManager(this);
-    this->url = url;
+    // Create directory
+    QDir dir(downloadPath);
+    dir.mkpath(downloadPath);
 }
 
-void RazerImageDownloader::startDownload()
+RazerImageDownloader::~RazerImageDownloader() = default;
+
+RazerImageDownloader *RazerImageDownloader::instance()
 {
-    QString path = getDownloadPath();
-    // Create directory
-    QDir dir(path);
-    dir.mkpath(path);
+    static RazerImageDownloader *downloader = new RazerImageDownloader(new QNetworkAccessManager(qApp), getDownloadPath(), qApp);
+    return downloader;
+}
+
+QString RazerImageDownloader::filePathFor(const QUrl &url) const
+{
+    return downloadPath + QFileInfo(url.path()).fileName();
+}
 
-    _filepath = path + QFileInfo(url.path()).fileName();
-    _file = new QFile(_filepath);
-    if (_file->exists()) {
+/*
+ * Hashing a large image takes a while, so this runs on the thread pool and
+ * only once per run for each image.
+ */
+RazerImageDownloader::CacheCheck RazerImageDownloader::checkCache(const QString &filePath)
+{
+    CacheCheck check;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return check;
+    check.exists = true;
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(&file);
+    QString sha256 = QString::fromLatin1(hash.result().toHex());
+
+    QFile metadataFile(filePath + ".json");
+    if (!metadataFile.open(QIODevice::ReadOnly)) {
+        // From before metadata got stored, nothing to check it against
+        check.valid = true;
+        check.adoptedMetadata.insert("size", file.size());
+        check.adoptedMetadata.insert("sha256", sha256);
+        return check;
+    }
+
+    QJsonObject metadata = QJsonDocument::fromJson(metadataFile.readAll()).object();
+    check.valid = metadata.value("size").toInteger(-1) == file.size() && metadata.value("sha256").toString() == sha256;
+    return check;
+}
+
+void RazerImageDownloader::cacheChecked(const QUrl &url, const CacheCheck &check)
+{
+    QString filePath = filePathFor(url);
+    if (!check.adoptedMetadata.isEmpty() && !writeMetadata(url, check.adoptedMetadata))
+        qWarning() << "RazerImageDownloader: Failed to store metadata for" << url;
+
+    if (check.valid) {
+        verified.insert(url);
+    } else if (check.exists) {
+        // Incomplete or damaged
+        qWarning() << "RazerImageDownloader: Discarding invalid cached image" << filePath;
+        QFile::remove(filePath);
+        QFile::remove(filePath + ".json");
+    }
+
+    for (const Waiter &waiter : checking.take(url))
+        fetchChecked(url, waiter, check.valid);
+}
+
+QJsonObject RazerImageDownloader::readMetadata(const QUrl &url) const
+{
+    QFile file(filePathFor(url) + ".json");
+    if (!file.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+bool RazerImageDownloader::writeMetadata(const QUrl &url, const QJsonObject &metadata)
+{
+    QSaveFile file(filePathFor(url) + ".json");
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(metadata).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void RazerImageDownloader::fetch(const QUrl &url, QObject *context,
+                                 std::function<void(QString &filename)> finished,
+                                 std::function<void(QString reason, QString longReason)> errored)
+{
+    Waiter waiter = { context, finished, errored };
+    if (verified.contains(url)) {
+        fetchChecked(url, waiter, true);
         return;
     }
-    if (!settings.value("downloadImages").toBool()) {
-        emit downloadErrored(tr("Image download disabled"), tr("Image downloading is disabled. Visit the preferences to enable it."));
+
+    // Another request is waiting for the check already
+    auto it = checking.find(url);
+    if (it != checking.end()) {
+        it->append(waiter);
         return;
     }
+    checking.insert(url, { waiter });
 
-    // TODO: What happens when two devices of the same model are connected?
+    auto *watcher = new QFutureWatcher<CacheCheck>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+        CacheCheck check = watcher->result();
+        watcher->deleteLater();
+        cacheChecked(url, check);
+    });
+    watcher->setFuture(QtConcurrent::run(&RazerImageDownloader::checkCache, filePathFor(url)));
+}
 
-    QNetworkRequest request;
-    request.setUrl(url);
-    request.setRawHeader("User-Agent", "Mozilla Firefox");
+void RazerImageDownloader::fetchChecked(const QUrl &url, const Waiter &waiter, bool cached)
+{
+    bool downloadEnabled = settings.value("downloadImages").toBool();
 
-    connect(manager, &QNetworkAccessManager::finished, this, &RazerImageDownloader::finished);
+    QString filePath = filePathFor(url);
+    if (cached) {
+        notifyFinished({ waiter }, filePath);
+        // Only check once per run whether the image changed
+        if (revalidated.contains(url) || !downloadEnabled)
+            return;
+    } else if (!downloadEnabled) {
+        notifyErrored({ waiter }, tr("Image download disabled"), tr("Image downloading is disabled. Visit the preferences to enable it."));
+        return;
+    }
+
+    // Devices of the same model share one job
+    auto it = jobs.find(url);
+    if (it == jobs.end()) {
+        it = jobs.insert(url, Job());
+        it->revalidate = cached;
+        queue.append(url);
+    }
 
-    manager->get(request);
+    if (cached)
+        it->updateWaiters.append(waiter);
+    else
+        it->waiters.append(waiter);
+
+    startNext();
 }
 
-RazerImageDownloader::~RazerImageDownloader()
+void RazerImageDownloader::startNext()
 {
-    // TODO: Complete destructor (no idea how they work / what you have to do)
-    delete _file;
-    delete manager;
+    while (running < MAX_CONCURRENT_DOWNLOADS && !queue.isEmpty()) {
+        QUrl url = queue.takeFirst();
+        Job &job = jobs[url];
+
+        QNetworkRequest request;
+        request.setUrl(url);
+        request.setRawHeader("User-Agent", "Mozilla Firefox");
+
+        if (job.revalidate) {
+            QJsonObject metadata = readMetadata(url);
+            if (metadata.contains("etag"))
+                request.setRawHeader("If-None-Match", metadata.value("etag").toString().toUtf8());
+            if (metadata.contains("lastModified"))
+                request.setRawHeader("If-Modified-Since", metadata.value("lastModified").toString().toUtf8());
+        }
+
+        QNetworkReply *reply = network->get(request);
+        job.reply = reply;
+        running++;
+
+        connect(reply, &QNetworkReply::readyRead, this, [=]() {
+            replyReadyRead(url, reply);
+        });
+        connect(reply, &QNetworkReply::finished, this, [=]() {
+            replyFinished(url, reply);
+        });
+    }
 }
 
-void RazerImageDownloader::finished(QNetworkReply *reply)
+/*
+ * Write the body to disk as it arrives, so the whole image never has to be
+ * kept in memory.
+ */
+void RazerImageDownloader::replyReadyRead(const QUrl &url, QNetworkReply *reply)
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        emit downloadErrored(tr("Network Error"), QVariant::fromValue(reply->error()).toString());
+    // Nothing to store for 304 Not Modified or error pages
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status < 200 || status >= 300) {
+        reply->readAll();
         return;
     }
 
-    _file->open(QFile::WriteOnly);
-    _file->write(reply->readAll());
-    _file->flush();
-    _file->close();
+    Job &job = jobs[url];
+    if (job.file == nullptr) {
+        job.file = new QSaveFile(filePathFor(url));
+        job.hash = new QCryptographicHash(QCryptographicHash::Sha256);
+        if (!job.file->open(QIODevice::WriteOnly))
+            qWarning() << "RazerImageDownloader: Failed to open" << job.file->fileName() << job.file->errorString();
+    }
+
+    QByteArray data = reply->readAll();
+    job.file->write(data);
+    job.hash->addData(data);
+    job.size += data.size();
+}
+
+void RazerImageDownloader::replyFinished(const QUrl &url, QNetworkReply *reply)
+{
+    // Pick up data which arrived together with the end of the reply
+    if (reply->bytesAvailable() > 0)
+        replyReadyRead(url, reply);
 
+    running--;
+    Job job = jobs.take(url);
     reply->deleteLater();
 
-    emit downloadFinished(_filepath);
+    if (reply->error() != QNetworkReply::NoError) {
+        // The update waiters keep using the cached image
+        if (job.revalidate)
+            qWarning() << "RazerImageDownloader: Failed to revalidate" << url << reply->error();
+        notifyErrored(job.waiters, tr("Network Error"), QVariant::fromValue(reply->error()).toString());
+    } else if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        // Not modified, the cached image is current
+        revalidated.insert(url);
+        notifyFinished(job.waiters, filePathFor(url));
+    } else if (job.file == nullptr || !job.file->commit()) {
+        // The cached image, if any, is left untouched
+        qWarning() << "RazerImageDownloader: Failed to store" << url;
+        notifyErrored(job.waiters, tr("Write Error"), tr("The downloaded image couldn't be saved."));
+    } else {
+        QString previousHash = readMetadata(url).value("sha256").toString();
+
+        QJsonObject metadata;
+        metadata.insert("size", job.size);
+        metadata.insert("sha256", QString::fromLatin1(job.hash->result().toHex()));
+        if (reply->hasRawHeader("ETag"))
+            metadata.insert("etag", QString::fromUtf8(reply->rawHeader("ETag")));
+        if (reply->hasRawHeader("Last-Modified"))
+            metadata.insert("lastModified", QString::fromUtf8(reply->rawHeader("Last-Modified")));
+        if (!writeMetadata(url, metadata))
+            qWarning() << "RazerImageDownloader: Failed to store metadata for" << url;
+
+        revalidated.insert(url);
+        verified.insert(url);
+        notifyFinished(job.waiters, filePathFor(url));
+        // The server can answer 200 without the image having changed
+        if (metadata.value("sha256").toString() != previousHash)
+            notifyFinished(job.updateWaiters, filePathFor(url));
+    }
+
+    // Discards the temporary file if it hasn't been committed
+    delete job.file;
+    delete job.hash;
+
+    startNext();
+}
+
+/*
+ * Callbacks get called from the event loop, also for cached images, so
+ * callers see the same order of events in all cases.
+ */
+void RazerImageDownloader::notifyFinished(const QList<Waiter> &waiters, QString filename)
+{
+    for (const Waiter &waiter : waiters) {
+        if (waiter.context.isNull())
+            continue;
+        auto finished = waiter.finished;
+        QMetaObject::invokeMethod(waiter.context, [=]() mutable { finished(filename); }, Qt::QueuedConnection);
+    }
+}
+
+void RazerImageDownloader::notifyErrored(const QList<Waiter> &waiters, const QString &reason, const QString &longReason)
+{
+    for (const Waiter &waiter : waiters) {
+        if (waiter.context.isNull())
+            continue;
+        auto errored = waiter.errored;
+        QMetaObject::invokeMethod(waiter.context, [=]() { errored(reason, longReason); }, Qt::QueuedConnection);
+    }
 }
 
 QString RazerImageDownloader::getDownloadPath()
@@ -5,30 +5,108 @@
 #ifndef RAZERIMAGEDOWNLOADER_H
 #define RAZERIMAGEDOWNLOADER_H
 
-#include <QFile>
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QJsonObject>
 #include <QNetworkReply>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSet>
 #include <QSettings>
+#include <functional>
 
+/*
+ * Downloads the device images into a local cache, shared by all devices.
+ *
+ * Requests for the same URL are merged into one download whose result goes
+ * to every caller, and only a few downloads run at the same time. Cached
+ * images are handed out right away and revalidated with the server once per
+ * run using the ETag / Last-Modified headers of the previous download.
+ *
+ * Downloads are streamed to a temporary file which only replaces the cached
+ * image once complete. The size and SHA-256 hash are stored next to each
+ * image and checked in the background before it gets used for the first
+ * time, so a broken image gets downloaded again instead of being used
+ * forever. Images cached by older versions, without that metadata, are
+ * adopted as they are.
+ *
+ * The network access manager and cache directory can be passed in, e.g. to
+ * run against a local HTTP server.
+ */
 class RazerImageDownloader : public QObject
 {
     Q_OBJECT
 public:
-    RazerImageDownloader(QUrl url, QObject *parent);
+    RazerImageDownloader(QNetworkAccessManager *network, const QString &downloadPath, QObject *parent = nullptr);
     ~RazerImageDownloader() override;
-    void startDownload();
+
+    static RazerImageDownloader *instance();
     static QString getDownloadPath();
-signals:
-    void downloadFinished(QString &filename);
-    void downloadErrored(QString reason, QString longReason);
+
+    /* Get the image at url. finished() gets the file name of the cached
+     * image, again if revalidation found a newer image. Nothing gets called
+     * if context has been destroyed in the meantime. */
+    void fetch(const QUrl &url, QObject *context,
+               std::function<void(QString &filename)> finished,
+               std::function<void(QString reason, QString longReason)> errored);
+
+    QString filePathFor(const QUrl &url) const;
 
 private:
-    QFile *_file;
-    QString _filepath;
-    QUrl url;
-    QNetworkAccessManager *manager;
+    struct Waiter {
+        QPointer<QObject> context;
+        std::function<void(QString &filename)> finished;
+        std::function<void(QString reason, QString longReason)> errored;
+    };
+
+    struct Job {
+        /* Still waiting for an image */
+        QList<Waiter> waiters;
+        /* Got the cached image already, only notified again if it changed */
+        QList<Waiter> updateWaiters;
+        /* The file is cached already, only ask whether it changed */
+        bool revalidate = false;
+        QNetworkReply *reply = nullptr;
+        /* Created when the body starts arriving */
+        QSaveFile *file = nullptr;
+        QCryptographicHash *hash = nullptr;
+        qint64 size = 0;
+    };
+
+    struct CacheCheck {
+        bool exists = false;
+        bool valid = false;
+        /* Metadata for an image cached before metadata got stored */
+        QJsonObject adoptedMetadata;
+    };
+
+    /* Whether filePath is a complete image, runs on the thread pool */
+    static CacheCheck checkCache(const QString &filePath);
+    void cacheChecked(const QUrl &url, const CacheCheck &check);
+    void fetchChecked(const QUrl &url, const Waiter &waiter, bool cached);
+    void startNext();
+    void replyReadyRead(const QUrl &url, QNetworkReply *reply);
+    void replyFinished(const QUrl &url, QNetworkReply *reply);
+    QJsonObject readMetadata(const QUrl &url) const;
+    bool writeMetadata(const QUrl &url, const QJsonObject &metadata);
+    void notifyFinished(const QList<Waiter> &waiters, QString filename);
+    void notifyErrored(const QList<Waiter> &waiters, const QString &reason, const QString &longReason);
+
+    QNetworkAccessManager *network;
+    QString downloadPath;
     QSettings settings;
-private slots:
-    void finished(QNetworkReply *reply);
+
+    QHash<QUrl, Job> jobs;
+    /* Jobs waiting for a free download slot, in request order */
+    QList<QUrl> queue;
+    int running = 0;
+    /* Images which have been revalidated during this run */
+    QSet<QUrl> revalidated;
+    /* Images whose size and hash have been checked during this run */
+    QSet<QUrl> verified;
+    /* Requests waiting for the check of the cached image */
+    QHash<QUrl, QList<Waiter>> checking;
 };
 
 #endif // RAZERIMAGEDOWNLOADER_H
@@ -0,0 +1,148 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "supporteddeviceindex.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+
+#define CACHE_MAGIC (0x52475349) // RGSI
+#define CACHE_FORMAT_VERSION (1)
+
+static inline quint32 packKey(int vid, int pid)
+{
+    return static_cast<quint32>(vid & 0xffff) << 16 | static_cast<quint32>(pid & 0xffff);
+}
+
+/* Fibonacci hashing, the table size is always a power of two */
+static inline quint32 slotFor(quint32 key, int tableSize)
+{
+    return (key * 2654435769u) & (tableSize - 1);
+}
+
+SupportedDeviceIndex SupportedDeviceIndex::load(libopenrazer::Manager *manager, const QString &daemonId)
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/razergenie/supporteddevices.idx";
+
+    SupportedDeviceIndex index;
+    if (index.readCache(path, daemonId))
+        return index;
+
+    try {
+        index.build(manager->getSupportedDevices());
+    } catch (const libopenrazer::DBusException &e) {
+        qWarning("Failed to get supported devices");
+        return index;
+    }
+    index.writeCache(path, daemonId);
+    return index;
+}
+
+bool SupportedDeviceIndex::contains(int vid, int pid) const
+{
+    if (table.isEmpty())
+        return false;
+
+    quint32 key = packKey(vid, pid);
+    // Probe until the key or an empty slot shows up, there always is one
+    for (quint32 slot = slotFor(key, table.size());; slot = (slot + 1) & (table.size() - 1)) {
+        if (table[slot] == key)
+            return true;
+        if (table[slot] == 0)
+            return false;
+    }
+}
+
+int SupportedDeviceIndex::size() const
+{
+    return count;
+}
+
+void SupportedDeviceIndex::build(const QHash<QString, QVariant> &supportedDevices)
+{
+    // Keep the load factor at 50% at most
+    int tableSize = 16;
+    while (tableSize < supportedDevices.size() * 2)
+        tableSize *= 2;
+    table.fill(0, tableSize);
+    count = 0;
+
+    for (auto it = supportedDevices.constBegin(); it != supportedDevices.constEnd(); ++it) {
+        QList<QVariant> list = it.value().toList();
+        if (list.count() != 2) {
+            qWarning() << "SupportedDeviceIndex: Invalid entry for" << it.key() << list;
+            continue;
+        }
+        insert(packKey(list[0].toInt(), list[1].toInt()));
+    }
+}
+
+void SupportedDeviceIndex::insert(quint32 key)
+{
+    if (key == 0)
+        return;
+
+    quint32 slot = slotFor(key, table.size());
+    while (table[slot] != 0) {
+        if (table[slot] == key)
+            return;
+        slot = (slot + 1) & (table.size() - 1);
+    }
+    table[slot] = key;
+    count++;
+}
+
+bool SupportedDeviceIndex::readCache(const QString &path, const QString &daemonId)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, formatVersion;
+    QString cachedDaemonId;
+    qint32 cachedCount;
+    QVector<quint32> cachedTable;
+    stream >> magic >> formatVersion;
+    if (stream.status() != QDataStream::Ok || magic != CACHE_MAGIC || formatVersion != CACHE_FORMAT_VERSION)
+        return false;
+    stream >> cachedDaemonId >> cachedCount >> cachedTable;
+    if (stream.status() != QDataStream::Ok || cachedDaemonId != daemonId)
+        return false;
+
+    // Only accept power of two sized tables with at least one empty slot,
+    // otherwise lookups would never terminate
+    if (cachedTable.isEmpty() || (cachedTable.size() & (cachedTable.size() - 1)) != 0 || !cachedTable.contains(0)) {
+        qWarning() << "SupportedDeviceIndex: Ignoring corrupt cache" << path;
+        return false;
+    }
+
+    table = cachedTable;
+    count = cachedCount;
+    return true;
+}
+
+void SupportedDeviceIndex::writeCache(const QString &path, const QString &daemonId) const
+{
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "SupportedDeviceIndex: Failed to write cache" << path;
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << quint32(CACHE_MAGIC) << quint32(CACHE_FORMAT_VERSION);
+    stream << daemonId << qint32(count) << table;
+    if (!file.commit())
+        qWarning() << "SupportedDeviceIndex: Failed to write cache" << path;
+}
@@ -0,0 +1,42 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SUPPORTEDDEVICEINDEX_H
+#define SUPPORTEDDEVICEINDEX_H
+
+#include <QString>
+#include <QVector>
+#include <libopenrazer.h>
+
+/*
+ * Set of the USB VID/PID pairs supported by the daemon, for telling apart
+ * unsupported devices from ones the daemon failed to pick up.
+ *
+ * The pairs are packed into 32-bit keys in an open addressing hash table,
+ * which gets cached on disk together with the daemon version it was built
+ * from. As long as the daemon doesn't change, the supported devices don't
+ * have to be fetched and converted again.
+ */
+class SupportedDeviceIndex
+{
+public:
+    /* daemonId identifies the daemon the cache is valid for, e.g. the
+     * backend and daemon version */
+    static SupportedDeviceIndex load(libopenrazer::Manager *manager, const QString &daemonId);
+
+    bool contains(int vid, int pid) const;
+    int size() const;
+
+private:
+    void build(const QHash<QString, QVariant> &supportedDevices);
+    void insert(quint32 key);
+    bool readCache(const QString &path, const QString &daemonId);
+    void writeCache(const QString &path, const QString &daemonId) const;
+
+    /* vid << 16 | pid, 0 marks an empty slot */
+    QVector<quint32> table;
+    int count = 0;
+};
+
+#endif // SUPPORTEDDEVICEINDEX_H
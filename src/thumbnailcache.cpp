@@ -0,0 +1,53 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thumbnailcache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+
+namespace thumbnailcache {
+
+static QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/razergenie/thumbnails/";
+}
+
+QImage thumbnail(const QString &sourcePath, const QSize &size, qreal devicePixelRatio)
+{
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly))
+        return QImage();
+
+    // Hashing is a lot cheaper than decoding the full-size image
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(&source);
+    source.close();
+
+    QSize pixelSize = size * devicePixelRatio;
+    QString cachePath = cacheDirectory()
+            + QString("%1-%2x%3.png").arg(QString::fromLatin1(hash.result().toHex())).arg(pixelSize.width()).arg(pixelSize.height());
+
+    QImage image;
+    if (!image.load(cachePath)) {
+        if (!image.load(sourcePath))
+            return QImage();
+        image = image.scaled(pixelSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+        // Writing the cache is best effort, the image is usable either way
+        QDir().mkpath(cacheDirectory());
+        QSaveFile file(cachePath);
+        if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "PNG") || !file.commit())
+            qWarning() << "Failed to write thumbnail" << cachePath;
+    }
+
+    image.setDevicePixelRatio(devicePixelRatio);
+    return image;
+}
+
+}
@@ -0,0 +1,26 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QImage>
+#include <QString>
+
+namespace thumbnailcache {
+
+/*
+ * Return the image at sourcePath scaled to fit into size (in device
+ * independent pixels) for the given device pixel ratio. Scaled images are
+ * kept on disk, keyed by the hash of the source image and the pixel size, so
+ * the full-size image only gets decoded the first time for each screen scale.
+ *
+ * This blocks on disk I/O and decoding and is meant to be called from the
+ * thread pool. Returns a null image if the source can't be read.
+ */
+QImage thumbnail(const QString &sourcePath, const QSize &size, qreal devicePixelRatio);
+
+}
+
+#endif // THUMBNAILCACHE_H
@@ -0,0 +1,70 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "usbscanner.h"
+
+#include <QDir>
+#include <QFile>
+#include <QtDebug>
+
+#define DEFAULT_SYSFS_ROOT "/sys/bus/usb/devices"
+
+/*
+ * Read a sysfs attribute holding a 16-bit hex number like "1532\n".
+ * Returns -1 if the file doesn't exist or is malformed.
+ */
+static int readHexAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    // The attributes are tiny, don't bother with anything else
+    char buf[16];
+    qint64 len = file.read(buf, sizeof(buf));
+    if (len <= 0)
+        return -1;
+
+    bool ok;
+    int value = QByteArray::fromRawData(buf, len).trimmed().toInt(&ok, 16);
+    if (!ok || value < 0 || value > 0xffff)
+        return -1;
+    return value;
+}
+
+UsbScanner::UsbScanner()
+    : UsbScanner(qEnvironmentVariable("RAZERGENIE_SYSFS_USB_DEVICES", DEFAULT_SYSFS_ROOT))
+{
+}
+
+UsbScanner::UsbScanner(const QString &sysfsRoot)
+    : sysfsRoot(sysfsRoot)
+{
+}
+
+QList<QPair<int, int>> UsbScanner::connectedDevices(int vendorId) const
+{
+    QList<QPair<int, int>> devices;
+
+    QDir root(sysfsRoot);
+    const QStringList entries = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString &entry : entries) {
+        // Interfaces like "1-2:1.0" don't have ids, only the devices do
+        if (entry.contains(':'))
+            continue;
+
+        QString devicePath = root.filePath(entry);
+        if (readHexAttribute(devicePath + "/idVendor") != vendorId)
+            continue;
+
+        int productId = readHexAttribute(devicePath + "/idProduct");
+        if (productId == -1) {
+            qWarning() << "UsbScanner: Malformed idProduct of" << devicePath;
+            continue;
+        }
+        devices.append(qMakePair(vendorId, productId));
+    }
+
+    return devices;
+}
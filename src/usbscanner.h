@@ -0,0 +1,33 @@
+// Copyright (C) 2026  Luca Weiss <luca (at) z3ntu (dot) xyz>
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef USBSCANNER_H
+#define USBSCANNER_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+/*
+ * Lists the USB devices connected to the PC by reading the idVendor and
+ * idProduct attributes from sysfs, without spawning any processes.
+ *
+ * The sysfs root can be overridden with the RAZERGENIE_SYSFS_USB_DEVICES
+ * environment variable, e.g. to point it to a fake tree of device
+ * directories which only contain those two files.
+ */
+class UsbScanner
+{
+public:
+    UsbScanner();
+    UsbScanner(const QString &sysfsRoot);
+
+    /* VID and PID of all connected devices from the given vendor */
+    QList<QPair<int, int>> connectedDevices(int vendorId) const;
+
+private:
+    QString sysfsRoot;
+};
+
+#endif // USBSCANNER_H